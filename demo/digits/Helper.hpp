@@ -37,10 +37,10 @@ std::pair<hlp::ivec2, hlp::ivec2> boundingBox(const unsigned char* image, int wi
 }
 
 // calculate random offset for digit image
-hlp::ivec2 randomOffset(int width, int height, std::pair<hlp::ivec2, hlp::ivec2> bb) {
+hlp::ivec2 randomOffset(int width, int height, std::pair<hlp::ivec2, hlp::ivec2> bb, Random& random) {
 	hlp::ivec2 randomOffsetV;
-	randomOffsetV.x = ((rand() % width) - width / 2 + 1) * 0.5f;
-	randomOffsetV.y = ((rand() % height) - height / 2 + 1) * 0.5f;
+	randomOffsetV.x = ((int)random.nextInt(width) - width / 2 + 1) * 0.5f;
+	randomOffsetV.y = ((int)random.nextInt(height) - height / 2 + 1) * 0.5f;
 
 	randomOffsetV.x = ((randomOffsetV.x + bb.second.x < width) ? randomOffsetV.x : (width - bb.second.x - 1));
 	randomOffsetV.y = ((randomOffsetV.y + bb.second.y < height) ? randomOffsetV.y : (height - bb.second.y - 1));
@@ -2,8 +2,119 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <bit>
+#include <type_traits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace IDX {
+	// element types, the third byte of the magic number
+	enum DataType : unsigned char {
+		UnsignedByte = 0x08,
+		SignedByte = 0x09,
+		Short = 0x0B,
+		Int = 0x0C,
+		Float = 0x0D,
+		Double = 0x0E
+	};
+
+	// bytes per element, 0 for types the format does not define
+	unsigned int getElementSize(unsigned char dataType) {
+		switch (dataType) {
+		case UnsignedByte:
+		case SignedByte:
+			return 1;
+		case Short:
+			return 2;
+		case Int:
+		case Float:
+			return 4;
+		case Double:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	// data type of the elements a typed view of type T reads
+	template <typename T>
+	constexpr unsigned char getDataType() {
+		if constexpr (std::is_same_v<T, std::uint8_t>) {
+			return UnsignedByte;
+		}
+		else if constexpr (std::is_same_v<T, std::int8_t>) {
+			return SignedByte;
+		}
+		else if constexpr (std::is_same_v<T, std::int16_t>) {
+			return Short;
+		}
+		else if constexpr (std::is_same_v<T, std::int32_t>) {
+			return Int;
+		}
+		else if constexpr (std::is_same_v<T, float>) {
+			return Float;
+		}
+		else {
+			static_assert(std::is_same_v<T, double>, "IDX files only store uint8_t, int8_t, int16_t, int32_t, float and double");
+			return Double;
+		}
+	}
+
+	// converts count elements of elementSize bytes in place between the MSB first order of the files and the order of this machine
+	// 16 bytes are swapped at once, the bytes of every element are reversed with shifts and word shuffles
+	void swapByteOrder(unsigned char* data, std::uint64_t count, unsigned int elementSize) {
+		if constexpr (std::endian::native == std::endian::big) {
+			return;
+		}
+		if (elementSize <= 1) {
+			return;
+		}
+
+		std::uint64_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+		const std::uint64_t vectorCount = count / (16 / elementSize) * 16;
+		for (; i < vectorCount; i += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+			// reverses the 16-bit words of every element, then the bytes of every word
+			if (elementSize == 4) {
+				v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+				v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+			}
+			else if (elementSize == 8) {
+				v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+				v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+			}
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			_mm_storeu_si128((__m128i*)(data + i), v);
+		}
+#endif
+		for (; i < count * elementSize; i += elementSize) {
+			for (unsigned int j = 0; j < elementSize / 2; j++) {
+				std::swap(data[i + j], data[i + elementSize - 1 - j]);
+			}
+		}
+	}
+
 	struct IDX_Header {
 		unsigned char dataType = 0;
 		unsigned char dimensions = 0;
@@ -21,12 +132,44 @@ namespace IDX {
 		~IDX_Header() {
 			delete[] sizes;
 		}
+
+		// product of all sizes, false when it does not fit in 64 bits
+		bool getElementCount(std::uint64_t& count) const {
+			count = 1;
+			for (int i = 0; i < dimensions; i++) {
+				if (sizes[i] == 0) {
+					count = 0;
+					return true;
+				}
+			}
+			for (int i = 0; i < dimensions; i++) {
+				if (count > std::numeric_limits<std::uint64_t>::max() / sizes[i]) {
+					return false;
+				}
+				count *= sizes[i];
+			}
+			return true;
+		}
 	};
 
+	// typed view of data with the given data type, throws when T does not match it
+	template <typename T>
+	std::span<const T> getView(const unsigned char* data, std::uint64_t count, unsigned char dataType) {
+		if (data == nullptr) {
+			return {};
+		}
+		if (getDataType<T>() != dataType) {
+			throw std::invalid_argument("View type does not match the IDX data type");
+		}
+		return std::span<const T>((const T*)data, (std::size_t)count);
+	}
+
 	struct IDX_Data {
 		IDX_Header header;
+		// elements in the byte order of this machine
 		unsigned char* data = nullptr;
-		unsigned int dataSize = 0;
+		// number of elements
+		std::uint64_t dataSize = 0;
 
 		IDX_Data() {}
 
@@ -39,6 +182,12 @@ namespace IDX {
 		~IDX_Data() {
 			delete[] data;
 		}
+
+		// elements as the type matching header.dataType, e.g. view<float>() for 0x0D
+		template <typename T>
+		std::span<const T> view() const {
+			return getView<T>(data, dataSize, header.dataType);
+		}
 	};
 
 	unsigned int readInt(std::ifstream& file) {
@@ -70,23 +219,239 @@ namespace IDX {
 			data.header.sizes[i] = readInt(file);
 		}
 
-		if (data.header.dataType != 0x08) {
-			std::cout << "Error: magic number is not 0x08\n";
+		const unsigned int elementSize = getElementSize(data.header.dataType);
+		if (elementSize == 0) {
+			std::cout << "Error: unsupported data type " << (int)data.header.dataType << '\n';
 			return data;
 		}
 
-		unsigned int size = 1;
-		for (int i = 0; i < data.header.dimensions; i++) {
-			size *= data.header.sizes[i];
+		std::uint64_t size;
+		if (!data.header.getElementCount(size)) {
+			std::cout << "Error: invalid sizes: " << path << '\n';
+			return data;
 		}
 		data.dataSize = size;
-		data.data = new unsigned char[size];
-		file.read((char*)data.data, sizeof(unsigned char) * size);
+		data.data = new unsigned char[size * elementSize];
+		file.read((char*)data.data, size * elementSize);
+		swapByteOrder(data.data, size, elementSize);
 
 		file.close();
 		return data;
 	}
 
+	// IDX file mapped read-only into memory, the payload is used straight from the page cache instead of being copied,
+	// so processes reading the same file share one physical copy and opening it takes the same time for any file size
+	// elements wider than a byte are stored MSB first, the first getNativeData or view call swaps them into a private copy
+	// of the whole payload, byte elements are always read from the page cache
+	class IDX_MappedData {
+	public:
+		// on failure an error is printed and the data is empty, see isValid
+		IDX_MappedData(const char* path) {
+			if (!map(path)) {
+				unmap();
+				return;
+			}
+			if (!parseHeader(path)) {
+				unmap();
+			}
+		}
+
+		IDX_MappedData(IDX_MappedData&& other) : header(std::move(other.header)), mapping(other.mapping), mappingSize(other.mappingSize), data(other.data),
+			elementCount(other.elementCount), nativeCopy(std::move(other.nativeCopy)), nativeCopyCreated(std::move(other.nativeCopyCreated)) {
+#ifdef _WIN32
+			file = other.file;
+			mappingHandle = other.mappingHandle;
+			other.file = INVALID_HANDLE_VALUE;
+			other.mappingHandle = nullptr;
+#endif
+			other.mapping = nullptr;
+			other.mappingSize = 0;
+			other.data = {};
+			other.elementCount = 0;
+		}
+
+		IDX_MappedData(const IDX_MappedData&) = delete;
+		IDX_MappedData& operator=(const IDX_MappedData&) = delete;
+
+		~IDX_MappedData() {
+			unmap();
+		}
+
+		bool isValid() const {
+			return data.data() != nullptr;
+		}
+
+		const IDX_Header& getHeader() const {
+			return header;
+		}
+
+		// payload as stored in the file, sizes[0] items stored one after another, elements wider than a byte MSB first
+		std::span<const unsigned char> getData() const {
+			return data;
+		}
+
+		// payload in the byte order of this machine and aligned for its elements, elements wider than a byte are copied and
+		// swapped on the first call, can be called from several threads at once
+		std::span<const unsigned char> getNativeData() const {
+			if (data.empty()) {
+				return data;
+			}
+			const unsigned int elementSize = getElementSize(header.dataType);
+			const bool swapped = elementSize > 1 && std::endian::native == std::endian::little;
+			// the header of a file with an even number of dimensions leaves doubles 4 bytes off their alignment
+			if (!swapped && (std::uintptr_t)data.data() % elementSize == 0) {
+				return data;
+			}
+			std::call_once(*nativeCopyCreated, [this, elementSize]() {
+				nativeCopy = std::make_unique<std::uint64_t[]>((data.size() + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+				std::memcpy(nativeCopy.get(), data.data(), data.size());
+				swapByteOrder((unsigned char*)nativeCopy.get(), elementCount, elementSize);
+			});
+			return std::span<const unsigned char>((const unsigned char*)nativeCopy.get(), data.size());
+		}
+
+		// number of elements
+		std::uint64_t getElementCount() const {
+			return elementCount;
+		}
+
+		// elements as the type matching the data type of the header, e.g. view<float>() for 0x0D, see getNativeData
+		template <typename T>
+		std::span<const T> view() const {
+			// checks the type before a copy is made
+			getView<T>(data.data(), elementCount, header.dataType);
+			return getView<T>(getNativeData().data(), elementCount, header.dataType);
+		}
+
+	private:
+		IDX_Header header;
+		const unsigned char* mapping = nullptr;
+		std::size_t mappingSize = 0;
+		std::span<const unsigned char> data;
+		std::uint64_t elementCount = 0;
+		// payload in the byte order of this machine, created by getNativeData when the mapping cannot be used as it is
+		mutable std::unique_ptr<std::uint64_t[]> nativeCopy;
+		std::unique_ptr<std::once_flag> nativeCopyCreated = std::make_unique<std::once_flag>();
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mappingHandle = nullptr;
+#endif
+
+		bool map(const char* path) {
+#ifdef _WIN32
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			LARGE_INTEGER fileSize;
+			if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+				std::cout << "Error: could not open file: " << path << '\n';
+				return false;
+			}
+			mappingSize = (std::size_t)fileSize.QuadPart;
+			if (mappingSize < 4) {
+				std::cout << "Error: file is too small: " << path << '\n';
+				return false;
+			}
+			mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mappingHandle != nullptr) {
+				mapping = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+			}
+#else
+			const int file = open(path, O_RDONLY);
+			struct stat fileStat;
+			if (file < 0 || fstat(file, &fileStat) != 0) {
+				if (file >= 0) {
+					close(file);
+				}
+				std::cout << "Error: could not open file: " << path << '\n';
+				return false;
+			}
+			mappingSize = (std::size_t)fileStat.st_size;
+			if (mappingSize < 4) {
+				close(file);
+				std::cout << "Error: file is too small: " << path << '\n';
+				return false;
+			}
+			void* address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, file, 0);
+			// the mapping keeps the file referenced on its own
+			close(file);
+			mapping = (address != MAP_FAILED) ? (const unsigned char*)address : nullptr;
+#endif
+			if (mapping == nullptr) {
+				std::cout << "Error: could not map file: " << path << '\n';
+				return false;
+			}
+			return true;
+		}
+
+		void unmap() {
+#ifdef _WIN32
+			if (mapping != nullptr) {
+				UnmapViewOfFile(mapping);
+			}
+			if (mappingHandle != nullptr) {
+				CloseHandle(mappingHandle);
+			}
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+			}
+			mappingHandle = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (mapping != nullptr) {
+				munmap((void*)mapping, mappingSize);
+			}
+#endif
+			mapping = nullptr;
+			mappingSize = 0;
+			data = {};
+			elementCount = 0;
+			nativeCopy.reset();
+		}
+
+		// MSB first
+		static unsigned int readInt(const unsigned char* bytes) {
+			return ((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) | (unsigned int)bytes[3];
+		}
+
+		// checks the magic number and that the payload the sizes describe is in the file
+		bool parseHeader(const char* path) {
+			if (mapping[0] != 0 || mapping[1] != 0) {
+				std::cout << "Error: invalid magic number: " << path << '\n';
+				return false;
+			}
+			header.dataType = mapping[2];
+			header.dimensions = mapping[3];
+			const unsigned int elementSize = getElementSize(header.dataType);
+			if (elementSize == 0) {
+				std::cout << "Error: unsupported data type " << (int)header.dataType << '\n';
+				return false;
+			}
+
+			const std::size_t headerSize = 4 + 4 * (std::size_t)header.dimensions;
+			if (header.dimensions == 0 || mappingSize < headerSize) {
+				std::cout << "Error: invalid header: " << path << '\n';
+				return false;
+			}
+			header.sizes = new unsigned int[header.dimensions];
+			for (int i = 0; i < header.dimensions; i++) {
+				header.sizes[i] = readInt(mapping + 4 + 4 * i);
+			}
+			std::uint64_t count;
+			if (!header.getElementCount(count) || count > (mappingSize - headerSize) / elementSize) {
+				std::cout << "Error: file is truncated: " << path << '\n';
+				return false;
+			}
+
+			elementCount = count;
+			data = std::span<const unsigned char>(mapping + headerSize, (std::size_t)count * elementSize);
+			return true;
+		}
+	};
+
+	// maps the file read-only, see IDX_MappedData for the copy made for elements wider than a byte
+	IDX_MappedData map(const char* path) {
+		return IDX_MappedData(path);
+	}
+
 	void printHeader(const IDX_Header& header) {
 		if (header.sizes != nullptr) {
 			std::cout << "Data type: " << (int)header.dataType << '\n';
@@ -99,14 +464,54 @@ namespace IDX {
 		}
 	}
 
+	constexpr unsigned int printedElementCount = 10;
+
+	// prints the first elements of data, which holds count elements of the given type
+	void printElements(const unsigned char* data, std::uint64_t count, unsigned char dataType) {
+		if (data == nullptr) {
+			return;
+		}
+		std::cout << "Data: ";
+		for (std::uint64_t i = 0; i < printedElementCount && i < count; i++) {
+			switch (dataType) {
+			case UnsignedByte:
+				std::cout << (int)data[i] << ' ';
+				break;
+			case SignedByte:
+				std::cout << (int)((const std::int8_t*)data)[i] << ' ';
+				break;
+			case Short:
+				std::cout << ((const std::int16_t*)data)[i] << ' ';
+				break;
+			case Int:
+				std::cout << ((const std::int32_t*)data)[i] << ' ';
+				break;
+			case Float:
+				std::cout << ((const float*)data)[i] << ' ';
+				break;
+			case Double:
+				std::cout << ((const double*)data)[i] << ' ';
+				break;
+			}
+		}
+		std::cout << '\n';
+	}
+
 	void printData(const IDX_Data& data) {
 		printHeader(data.header);
-		if (data.data != nullptr) {
-			std::cout << "Data: ";
-			for (int i = 0; i < 10; i++) {
-				std::cout << (int)data.data[i] << ' ';
-			}
-			std::cout << '\n';
+		printElements(data.data, data.dataSize, data.header.dataType);
+	}
+
+	void printData(const IDX_MappedData& data) {
+		printHeader(data.getHeader());
+		// only the printed elements are swapped, so printing does not copy the payload
+		const unsigned char dataType = data.getHeader().dataType;
+		const std::uint64_t count = std::min<std::uint64_t>(data.getElementCount(), printedElementCount);
+		std::uint64_t elements[printedElementCount];
+		if (count > 0) {
+			std::memcpy(elements, data.getData().data(), count * getElementSize(dataType));
+			swapByteOrder((unsigned char*)elements, count, getElementSize(dataType));
 		}
+		printElements((count > 0) ? (const unsigned char*)elements : nullptr, count, dataType);
 	}
-}
+}
\ No newline at end of file
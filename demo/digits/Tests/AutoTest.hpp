@@ -1,23 +1,29 @@
 #pragma once
 
+#include <chrono>
+
 #include "Test.hpp"
 
 class AutoTest : public Test {
 public:
 	AutoTest(const char* testImagesSrc, const char* testLabelsSrc) :
-		testImages(IDX::import(testImagesSrc)),
-		testLabels(IDX::import(testLabelsSrc)),
+		testImages(IDX::map(testImagesSrc)),
+		testLabels(IDX::map(testLabelsSrc)),
 		Test(28, 28),
 		testDataIndex(0) {
 
 		IDX::printData(this->testImages);
 		IDX::printData(this->testLabels);
+
+		// the whole test set is evaluated as one batch read straight from the mapped file
+		const unsigned int testCount = this->testImages.getHeader().sizes[0];
+		testSetOutputs.resize(testCount * 10);
 	}
 
 	void run(Network& network) override {
 		// Test network
-		const unsigned char* timage = testImages.data + testDataIndex * imageSize;
-		const unsigned char tlabel = testLabels.data[testDataIndex];
+		const unsigned char* timage = testImages.getData().data() + testDataIndex * imageSize;
+		const unsigned char tlabel = testLabels.getData()[testDataIndex];
 
 		for (int i = 0; i < 28 * 28; i++) {
 			testData.inputs(i) = (float)timage[i] / 255.0f;
@@ -61,14 +67,43 @@ public:
 		}
 		std::cout << std::endl;
 
-		testDataIndex = (testDataIndex + 1) % testImages.header.sizes[0];
+		// the whole test set takes much longer than a single image, so it is evaluated only every testSetInterval
+		const auto now = std::chrono::steady_clock::now();
+		if (!testSetEvaluated || now - lastTestSetEvaluation >= testSetInterval) {
+			evaluateTestSet(network);
+			lastTestSetEvaluation = now;
+			testSetEvaluated = true;
+		}
+
+		testDataIndex = (testDataIndex + 1) % testImages.getHeader().sizes[0];
 
 		Test::run(network);
 	}
 
 private:
-	const IDX::IDX_Data testImages;
-	const IDX::IDX_Data testLabels;
+	const IDX::IDX_MappedData testImages;
+	const IDX::IDX_MappedData testLabels;
 
 	int testDataIndex;
+
+	std::vector<float> testSetOutputs;
+	static constexpr std::chrono::seconds testSetInterval{ 10 };
+	std::chrono::steady_clock::time_point lastTestSetEvaluation;
+	bool testSetEvaluated = false;
+
+	// prints the share of test images the network classifies correctly
+	void evaluateTestSet(Network& network) {
+		const unsigned int testCount = testImages.getHeader().sizes[0];
+		// pixels are normalized to [0, 1] by the first layer as it reads them
+		network.predictBatch(InputBatch(testImages.getData().data(), testCount, 1.0f / 255.0f), testSetOutputs.data());
+
+		unsigned int correct = 0;
+		for (unsigned int iTest = 0; iTest < testCount; iTest++) {
+			const float* outputs = &testSetOutputs[iTest * 10];
+			if (std::max_element(outputs, outputs + 10) - outputs == testLabels.getData()[iTest]) {
+				correct++;
+			}
+		}
+		std::cout << "Test set accuracy: " << std::fixed << std::setprecision(2) << 100.0f * correct / testCount << "%\n";
+	}
 };
@@ -34,8 +34,8 @@ public:
 			network.setInputs(testData, 0);
 			network.propagateForward(0);
 
-			*averageResults(iDigit) *= 0.9f;
-			*averageResults(iDigit) += *network.getOutputLayer()->getOutputs()(0);
+			averageResults(iDigit) *= 0.9f;
+			averageResults(iDigit) += network.getOutputLayer()->getOutputs()(0);
 
 			// find output with highest value
 			int maxIndex = 0;
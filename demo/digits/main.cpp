@@ -19,8 +19,14 @@
 		// size of the batch
 			#define BATCH_SIZE 32
 
-		// number of threads used for training, set to 0 or not define to disable multithreading
-			#define THREAD_POOL_SIZE 4
+		// number of threads used for training, 0 uses all hardware threads, 1 disables multithreading
+			#define THREAD_COUNT 4
+
+		// number of threads preparing the next batches in the background while a batch trains
+			#define LOADER_THREAD_COUNT 1
+
+		// When defined, the output layer uses softmax with cross-entropy loss instead of sigmoid with mean squared error
+			//#define CROSS_ENTROPY
 
 	// --------OTHER--------
 		// AUTO_TEST defined: size of the preview window (set to -1 to disable)
@@ -58,6 +64,8 @@
 #include "ThreadPool.hpp"
 #include "Layer.hpp"
 #include "Network.hpp"
+#include "DataLoader.hpp"
+#include "Sampler.hpp"
 
 #include "IDX_Importer.hpp"
 
@@ -77,19 +85,19 @@
 
 int main(int argc, char** argv) {
 
-	IDX::IDX_Data trainImages = IDX::import("dataset/train-images.idx3-ubyte");
+	IDX::IDX_MappedData trainImages = IDX::map("dataset/train-images.idx3-ubyte");
 	IDX::printData(trainImages);
-	IDX::IDX_Data trainLabels = IDX::import("dataset/train-labels.idx1-ubyte");
+	IDX::IDX_MappedData trainLabels = IDX::map("dataset/train-labels.idx1-ubyte");
 	IDX::printData(trainLabels);
 
-	const int width = trainImages.header.sizes[1];
-	const int height = trainImages.header.sizes[2];
+	const int width = trainImages.getHeader().sizes[1];
+	const int height = trainImages.getHeader().sizes[2];
 	const int imageSize = width * height;
 
 	// calculate bounding boxes for each digit
-	std::vector<std::pair<hlp::ivec2, hlp::ivec2>> boundingBoxes(trainImages.header.sizes[0]);
-	for (int i = 0; i < trainImages.header.sizes[0]; i++) {
-		const unsigned char* image = trainImages.data + i * width * height;
+	std::vector<std::pair<hlp::ivec2, hlp::ivec2>> boundingBoxes(trainImages.getHeader().sizes[0]);
+	for (int i = 0; i < trainImages.getHeader().sizes[0]; i++) {
+		const unsigned char* image = trainImages.getData().data() + i * width * height;
 		boundingBoxes[i] = boundingBox(image, width, height);
 	}
 
@@ -105,34 +113,30 @@ int main(int argc, char** argv) {
 	#endif
 #endif
 
-	srand(time(NULL));
+	const std::uint64_t seed = time(NULL);
+	seedThreadRandom(seed);
 
-	Network network({ 28 * 28, 100, 100, 10 });
+#ifdef CROSS_ENTROPY
+	Network network({ 28 * 28, 100, 100, 10 }, { Activation::Sigmoid, Activation::Sigmoid, Activation::Softmax }, BATCH_SIZE, THREAD_COUNT);
+	network.setLoss(Loss::CrossEntropy);
+#else
+	Network network({ 28 * 28, 100, 100, 10 }, BATCH_SIZE, THREAD_COUNT);
+#endif
 	network.setLearningRate(0.1f);
 
-	std::vector<TrainingData> trData;
-	trData.reserve(BATCH_SIZE);
-	for (int i = 0; i < BATCH_SIZE; i++) {
-		trData.emplace_back(28 * 28, 10);
-	}
-
-	auto start = std::chrono::high_resolution_clock::now();
-	int lastIteration = 0;
-	int iteration = -1;
-
-	while (true) {
-		iteration++;
-
 #ifdef TRAIN
-		int trDataIndex = iteration % trainImages.header.sizes[0];
-		const unsigned char* image = trainImages.data + trDataIndex * imageSize;
-		const unsigned char label = trainLabels.data[trDataIndex];
+	// every epoch visits the training set in a new order, with every batch holding the digits in their usual proportions
+	StratifiedSampler sampler(trainLabels.getData().data(), trainImages.getHeader().sizes[0], seed);
+	DataLoader loader(28 * 28, 10, BATCH_SIZE, [&](TrainingData& sample, std::uint64_t sampleIndex) {
+		const unsigned int trDataIndex = sampler.getIndex(sampleIndex);
+		const unsigned char* image = trainImages.getData().data() + trDataIndex * imageSize;
+		const unsigned char label = trainLabels.getData()[trDataIndex];
 
 		// apply random offset to digit image, so that the network can learn to recognize digits which are not centered
 		std::pair<hlp::ivec2, hlp::ivec2> bb = boundingBoxes[trDataIndex];
-		hlp::ivec2 randomOffsetV = randomOffset(width, height, bb);
-
-		int batchSample = iteration % BATCH_SIZE;
+		// every sample has its own stream, so the augmentation does not depend on which loader thread prepares it
+		Random random(seed, sampleIndex);
+		hlp::ivec2 randomOffsetV = randomOffset(width, height, bb, random);
 
 		// set inputs
 		for (int y = 0; y < height; y++) {
@@ -140,67 +144,74 @@ int main(int argc, char** argv) {
 				int randomX = x - randomOffsetV.x;
 				int randomY = y - randomOffsetV.y;
 				if (randomX < 0 || randomX >= width || randomY < 0 || randomY >= height) {
-					trData[batchSample].inputs(y * width + x) = 0.0f;
+					sample.inputs(y * width + x) = 0.0f;
 					continue;
 				}
-				trData[batchSample].inputs(y * width + x) = (float)image[randomY * width + randomX] / 255.0f;
+				sample.inputs(y * width + x) = (float)image[randomY * width + randomX] / 255.0f;
 			}
 		}
 		// set outputs
 		for (int i = 0; i < 10; i++) {
-			trData[batchSample].outputs(i) = (i == label) ? 1.0f : 0.0f;
+			sample.outputs(i) = (i == label) ? 1.0f : 0.0f;
 		}
+	}, 2, LOADER_THREAD_COUNT);
+#endif // TRAIN
 
-		if (iteration % BATCH_SIZE == BATCH_SIZE - 1) {
-			// train network
-			network.trainBatch(trData);
-		}
+	auto start = std::chrono::high_resolution_clock::now();
+	int lastIteration = 0;
+	int iteration = 0;
+
+	while (true) {
+#ifdef TRAIN
+		// the next batch is prepared by the loader while this one trains
+		network.trainBatch(loader.next());
+		iteration += BATCH_SIZE;
+#else
+		iteration++;
 #endif // TRAIN
 
-		if (iteration % 100 == 0) {
-			auto end = std::chrono::high_resolution_clock::now();
-			std::chrono::duration<double, std::milli> diff = end - start;
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double, std::milli> diff = end - start;
 
-			if (diff.count() >= TEST_DELAY) {
-				start = end;
+		if (diff.count() >= TEST_DELAY) {
+			start = end;
 #ifdef TEST
-				test->run(network);
+			test->run(network);
 
 #ifdef TRAIN
-				std::cout << "Training speed: " << (iteration - lastIteration) / diff.count() * 1000 << " iterations per second\n";
-				lastIteration = iteration;
+			std::cout << "Training speed: " << (iteration - lastIteration) / diff.count() * 1000 << " iterations per second\n";
+			lastIteration = iteration;
 #endif // TRAIN
 
 #else // !TEST
-				std::cout << "Iteration: " << iteration << " ,";
-				std::cout << "Training speed: " << (iteration - lastIteration) / diff.count() * 1000 << " iterations per second\n";
-				lastIteration = iteration;
+			std::cout << "Iteration: " << iteration << " ,";
+			std::cout << "Training speed: " << (iteration - lastIteration) / diff.count() * 1000 << " iterations per second\n";
+			lastIteration = iteration;
 #endif // TEST
 
-				// handle user keyboard input
-				bool quit = false;
-				SDL_Event event;
-				const Uint8* keystates = engine::IO::getKeys(&event, &quit);
-				if (keystates[SDL_SCANCODE_ESCAPE]) {
-					quit = true;
-				}
-				if (keystates[SDL_SCANCODE_SPACE]) {
-					// clear canvas if space is pressed and is instance of CanvasTest
-					CanvasTest* canvasTest = dynamic_cast<CanvasTest*>(test);
-					if (canvasTest != nullptr) {
-						canvasTest->clearCanvas();
-					}
-				}
-				if (keystates[SDL_SCANCODE_S]) {
-					network.save(SAVE_PATH);
-				}
-				if (keystates[SDL_SCANCODE_L]) {
-					network.load(LOAD_PATH);
-				}
-				if (quit) {
-					return 0;
+			// handle user keyboard input
+			bool quit = false;
+			SDL_Event event;
+			const Uint8* keystates = engine::IO::getKeys(&event, &quit);
+			if (keystates[SDL_SCANCODE_ESCAPE]) {
+				quit = true;
+			}
+			if (keystates[SDL_SCANCODE_SPACE]) {
+				// clear canvas if space is pressed and is instance of CanvasTest
+				CanvasTest* canvasTest = dynamic_cast<CanvasTest*>(test);
+				if (canvasTest != nullptr) {
+					canvasTest->clearCanvas();
 				}
 			}
+			if (keystates[SDL_SCANCODE_S]) {
+				network.save(SAVE_PATH);
+			}
+			if (keystates[SDL_SCANCODE_L]) {
+				network.load(LOAD_PATH);
+			}
+			if (quit) {
+				return 0;
+			}
 		}
 	}
 
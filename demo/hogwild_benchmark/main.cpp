@@ -0,0 +1,146 @@
+// ------------------- CONFIG -------------------
+	// number of threads used for training, 0 uses all hardware threads
+		#define THREAD_COUNT 0
+
+	// samples of a synchronous batch, the parameters are updated once per batch
+		#define BATCH_SIZE 32
+
+	// samples every Hogwild thread trains between its own updates
+		#define HOGWILD_MINI_BATCH_SIZE 32
+
+	// test set accuracy both training modes have to reach
+		#define TARGET_ACCURACY 0.95f
+
+	// training stops after this many seconds when the target accuracy is not reached
+		#define MAX_SECONDS 120
+
+	// samples trained between evaluations of the test set, Hogwild training gets all of them in a single trainBatch call,
+	// so its threads only wait for each other once per interval
+		#define EVALUATION_INTERVAL 10000
+// ----------------------------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include "Network.hpp"
+#include "Sampler.hpp"
+#include "IDX_Importer.hpp"
+
+// compares time to accuracy of synchronous and Hogwild training on the digits dataset
+
+struct Dataset {
+	// pixels of all samples one after another, normalized by the first layer
+	std::vector<unsigned char> images;
+	std::vector<unsigned char> labels;
+	unsigned int imageSize = 0;
+};
+
+bool loadDataset(const char* imagesPath, const char* labelsPath, Dataset& dataset) {
+	IDX::IDX_MappedData images = IDX::map(imagesPath);
+	IDX::IDX_MappedData labels = IDX::map(labelsPath);
+	if (!images.isValid() || !labels.isValid()) {
+		return false;
+	}
+
+	const unsigned int count = images.getHeader().sizes[0];
+	dataset.imageSize = images.getHeader().sizes[1] * images.getHeader().sizes[2];
+	dataset.images.assign(images.getData().begin(), images.getData().begin() + count * dataset.imageSize);
+	dataset.labels.assign(labels.getData().begin(), labels.getData().begin() + count);
+	return true;
+}
+
+// samples of an evaluation interval in the order of the sampler, gathered before the interval is timed
+struct SampleStream {
+	std::vector<unsigned char> images;
+	std::vector<float> targets;
+
+	void gather(const Dataset& train, ShuffledSampler& sampler, std::uint64_t firstSample, unsigned int count) {
+		images.resize((std::size_t)count * train.imageSize);
+		targets.assign(count * 10, 0.0f);
+		for (unsigned int i = 0; i < count; i++) {
+			const unsigned int index = sampler.getIndex(firstSample + i);
+			std::copy_n(train.images.begin() + (std::size_t)index * train.imageSize, train.imageSize, images.begin() + (std::size_t)i * train.imageSize);
+			targets[i * 10 + train.labels[index]] = 1.0f;
+		}
+	}
+};
+
+float evaluate(Network& network, const Dataset& test) {
+	const unsigned int count = test.labels.size();
+	std::vector<float> outputs(count * 10);
+	network.predictBatch(InputBatch(test.images.data(), count, 1.0f / 255.0f), outputs.data());
+
+	unsigned int correct = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		const float* sampleOutputs = &outputs[i * 10];
+		if (std::max_element(sampleOutputs, sampleOutputs + 10) - sampleOutputs == test.labels[i]) {
+			correct++;
+		}
+	}
+	return (float)correct / count;
+}
+
+// trains until the test set accuracy reaches TARGET_ACCURACY, returns the training time in seconds without the evaluations
+double timeToAccuracy(TrainingMode mode, const Dataset& train, const Dataset& test, float& accuracy) {
+	// both modes start from the same weights and visit the samples in the same order
+	seedThreadRandom(0);
+	ShuffledSampler sampler(train.labels.size(), 0);
+	Network network({ 28 * 28, 100, 100, 10 }, { Activation::Sigmoid, Activation::Sigmoid, Activation::Softmax }, BATCH_SIZE, THREAD_COUNT);
+	network.setLoss(Loss::CrossEntropy);
+	network.setLearningRate(0.05f);
+	network.setTrainingMode(mode);
+	network.setHogwildMiniBatchSize(HOGWILD_MINI_BATCH_SIZE);
+
+	SampleStream stream;
+	double seconds = 0.0;
+	std::uint64_t sample = 0;
+	accuracy = 0.0f;
+	while (accuracy < TARGET_ACCURACY && seconds < MAX_SECONDS) {
+		stream.gather(train, sampler, sample, EVALUATION_INTERVAL);
+		sample += EVALUATION_INTERVAL;
+		const InputBatch batch(stream.images.data(), EVALUATION_INTERVAL);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (mode == TrainingMode::Hogwild) {
+			// every thread takes mini-batches from the whole interval until it runs out
+			network.trainBatch(batch, stream.targets.data());
+		}
+		else {
+			for (unsigned int i = 0; i < EVALUATION_INTERVAL; i += BATCH_SIZE) {
+				const unsigned int count = std::min<unsigned int>(BATCH_SIZE, EVALUATION_INTERVAL - i);
+				network.trainBatch(batch.slice(i, count, train.imageSize), stream.targets.data() + i * 10);
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		seconds += std::chrono::duration<double>(end - start).count();
+
+		accuracy = evaluate(network, test);
+		std::cout << ((mode == TrainingMode::Hogwild) ? "hogwild" : "synchronous") << ": " << std::fixed << std::setprecision(2)
+			<< seconds << " s, accuracy " << accuracy * 100.0f << "%\n";
+	}
+	return seconds;
+}
+
+int main() {
+	Dataset train;
+	Dataset test;
+	if (!loadDataset("dataset/train-images.idx3-ubyte", "dataset/train-labels.idx1-ubyte", train) ||
+		!loadDataset("dataset/t10k-images.idx3-ubyte", "dataset/t10k-labels.idx1-ubyte", test)) {
+		std::cout << "Failed to load the digits dataset, see demo/digits/dataset/readme.md\n";
+		return 1;
+	}
+
+	float synchronousAccuracy;
+	float hogwildAccuracy;
+	const double synchronousTime = timeToAccuracy(TrainingMode::Synchronous, train, test, synchronousAccuracy);
+	const double hogwildTime = timeToAccuracy(TrainingMode::Hogwild, train, test, hogwildAccuracy);
+
+	std::cout << "\ntime to " << TARGET_ACCURACY * 100.0f << "% test accuracy\n";
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "synchronous: " << synchronousTime << " s (" << synchronousAccuracy * 100.0f << "%)\n";
+	std::cout << "hogwild:     " << hogwildTime << " s (" << hogwildAccuracy * 100.0f << "%)\n";
+	return 0;
+}
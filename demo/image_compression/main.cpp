@@ -3,10 +3,9 @@
 #include <iomanip>
 #include <chrono>
 
-#define THREAD_POOL_SIZE 4
-
 #include "Layer.hpp"
 #include "Network.hpp"
+#include "Sampler.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -18,6 +17,8 @@
 
 #define BATCH_SIZE 32
 
+#define THREAD_COUNT 4
+
 int main(int argc, char** argv) {
 	int width, height, channels;
 	unsigned char* imageData = stbi_load("images/input.png", &width, &height, &channels, 0);
@@ -32,9 +33,10 @@ int main(int argc, char** argv) {
 	engine::Display display(width * previewSizeMultiplier, height * previewSizeMultiplier, "Learned image", false);
 	SDL_Event event;
 
-	srand(time(NULL));
+	const std::uint64_t seed = time(NULL);
+	seedThreadRandom(seed);
 
-	Network network({ 2, 30, 20, 10, 3 });
+	Network network({ 2, 30, 20, 10, 3 }, BATCH_SIZE, THREAD_COUNT);
 	network.setLearningRate(0.1f);
 
 	std::vector<TrainingData> trData;
@@ -43,13 +45,33 @@ int main(int argc, char** argv) {
 		trData.emplace_back(2, 3);
 	}
 
+	// coordinates and colors of every preview pixel, the preview is predicted as one batch
+	const int previewWidth = width * previewSizeMultiplier;
+	const int previewHeight = height * previewSizeMultiplier;
+	const unsigned int previewSize = previewWidth * previewHeight;
+	std::vector<float> previewInputs(previewSize * 2);
+	std::vector<float> previewTargets(previewSize * 3);
+	std::vector<float> previewOutputs(previewSize * 3);
+	for (int y = 0; y < previewHeight; y++) {
+		for (int x = 0; x < previewWidth; x++) {
+			const unsigned int i = y * previewWidth + x;
+			previewInputs[i * 2 + 0] = (float)x / (float)previewWidth;
+			previewInputs[i * 2 + 1] = (float)y / (float)previewHeight;
+			const int imageIndex = std::min((int)(y / previewSizeMultiplier), height - 1) * width + std::min((int)(x / previewSizeMultiplier), width - 1);
+			for (int c = 0; c < 3; c++) {
+				previewTargets[i * 3 + c] = (float)imageData[imageIndex * channels + c] / 255.0f;
+			}
+		}
+	}
+
 	auto start = std::chrono::high_resolution_clock::now();
 
-	const int samplingMultiplier = 1 + imageSize / RAND_MAX;
+	// every pixel is trained once per epoch, in a new order every epoch
+	ShuffledSampler pixelSampler(imageSize, seed);
 	for (int iteration = 0; iteration < 1000000000; iteration++) {
 		int trDataIndex = iteration % BATCH_SIZE;
 
-		int randomIndex = (rand() * samplingMultiplier) % imageSize;
+		int randomIndex = pixelSampler.getIndex(iteration);
 		trData[trDataIndex].outputs(0) = (float)imageData[randomIndex * channels + 0] / 255.0f;
 		trData[trDataIndex].outputs(1) = (float)imageData[randomIndex * channels + 1] / 255.0f;
 		trData[trDataIndex].outputs(2) = (float)imageData[randomIndex * channels + 2] / 255.0f;
@@ -61,19 +83,16 @@ int main(int argc, char** argv) {
 		}
 
 		if (iteration % 100000 == 0) {
+			network.predictBatch(previewInputs.data(), previewSize, previewOutputs.data());
+
 			float error = 0.0f;
-			const float previewWidth = width * previewSizeMultiplier;
-			const float previewHeight = height * previewSizeMultiplier;
 			for (int y = 0; y < previewHeight; y++) {
 				for (int x = 0; x < previewWidth; x++) {
-					trData[0].inputs(0) = (float)x / (float)previewWidth;
-					trData[0].inputs(1) = (float)y / (float)previewHeight;
-					network.setInputs(trData[0], 0);
-					network.propagateForward(0);
-					error += network.getError(trData[0], 0);
-					float r = network.getOutputLayer()->getOutputs()(0, 0);
-					float g = network.getOutputLayer()->getOutputs()(1, 0);
-					float b = network.getOutputLayer()->getOutputs()(2, 0);
+					const unsigned int i = y * previewWidth + x;
+					error += computeLoss(Loss::MeanSquaredError, Activation::Sigmoid, &previewOutputs[i * 3], &previewTargets[i * 3], 3);
+					float r = previewOutputs[i * 3 + 0];
+					float g = previewOutputs[i * 3 + 1];
+					float b = previewOutputs[i * 3 + 2];
 					hlp::color color = { (unsigned char)(r * 255.0f), (unsigned char)(g * 255.0f), (unsigned char)(b * 255.0f) };
 					display.drawPixel(x, y, color);					
 				}
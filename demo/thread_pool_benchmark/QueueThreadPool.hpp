@@ -0,0 +1,139 @@
+#pragma once
+
+// the previous thread pool with a single job queue behind one mutex, kept as the baseline of the benchmark
+
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <queue>
+#include <condition_variable>
+#include <cstring>
+
+struct QueueJob {
+	std::function<void(int, int)> job;
+	unsigned int repeat;
+	unsigned int repeatsLeft;
+};
+
+class QueueThreadPool {
+public:
+	QueueThreadPool(int threadCount) {
+		if (threadCount > 0) {
+			this->occupied = new bool[threadCount];
+			memset(this->occupied, false, threadCount * sizeof(bool));
+			this->threads.reserve(threadCount);
+			for (int i = 0; i < threadCount; i++) {
+				this->threads.push_back(std::thread(&QueueThreadPool::threadEntry, this, i));
+			}
+		}
+		else {
+			this->occupied = nullptr;
+		}
+	}
+
+	void addJob(const std::function<void(int, int)>& job, unsigned int repeat) {
+		std::unique_lock<std::mutex> lock(mutex);
+		this->jobs.push(QueueJob(job, repeat, repeat));
+		if (repeat >= threads.size()) {
+			cv.notify_all();
+		}
+		else {
+			for (int i = 0; i < repeat; i++) {
+				cv.notify_one();
+			}
+		}
+	}
+
+	bool isOccupied() {
+		if (occupied != nullptr) {
+			for (int i = 0; i < threads.size(); i++) {
+				if (occupied[i]) {
+					return true;
+				}
+			}
+		}
+		return !(jobs.size() <= 0);
+	}
+
+	void wait() {
+		std::unique_lock lock(waitMutex);
+		while (isOccupied()) {
+			workDone.wait(lock);
+		}
+	}
+
+	~QueueThreadPool() {
+		terminate = true;
+		cv.notify_all();
+
+		if (threads.size() > 0) {
+			std::cout << "Waiting for all threads ...\n";
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+		delete[] occupied;
+	}
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::mutex waitMutex;
+	std::queue<QueueJob> jobs;
+	std::condition_variable cv;
+	std::condition_variable workDone;
+	bool* occupied;
+	bool terminate = false;
+
+	void threadEntry(int threadId) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			std::cout << "Thread " << threadId << " started" << std::endl;
+		}
+
+		QueueJob job;
+		unsigned int repeat = 0;
+		while (true) {
+			if (terminate) {
+				return;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				while (jobs.size() <= 0) {
+					cv.wait(lock);
+					if (terminate) {
+						return;
+					}
+				}
+				occupied[threadId] = true;
+				QueueJob* front = &jobs.front();
+				job = *front;
+				if (job.repeatsLeft >= 1) {
+					repeat = job.repeat;
+					repeat /= threads.size();
+					repeat = std::max(std::min(job.repeatsLeft, repeat), 1u);
+
+					front->repeatsLeft -= repeat;
+				}
+				if (front->repeatsLeft <= 0) {
+					jobs.pop();
+				}
+				//std::cout << "Thread " << threadId << " got a job of " << repeat << " repeats" << std::endl;
+			}
+			while (repeat > 0) {
+				//std::cout << "Thread " << threadId <<  " " << job.repeatsLeft - repeat << std::endl;
+				job.job(job.repeatsLeft - repeat, threadId);
+				repeat--;
+			}
+			repeat = 0;
+			occupied[threadId] = false;
+			{
+				std::unique_lock<std::mutex> lock(waitMutex);
+				workDone.notify_all();
+			}
+		}
+	}
+};
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <type_traits>
+
+#include "ThreadPool.hpp"
+#include "QueueThreadPool.hpp"
+
+// compares the work-stealing ThreadPool with the previous single queue pool on workloads where the queue is contended
+
+#define REPEATS 5
+
+// per-thread results on separate cache lines, so the work itself does not contend
+struct alignas(64) Counter {
+	float value = 0.0f;
+};
+
+float work(int index, unsigned int iterations) {
+	float value = (float)index;
+	for (unsigned int i = 0; i < iterations; i++) {
+		value = value * 0.999f + 1.0f;
+	}
+	return value;
+}
+
+// many tiny repeats of a single job
+template <typename Pool>
+void fineGrained(Pool& pool, std::vector<Counter>& counters) {
+	pool.addJob([&counters](int index, int threadId) {
+		counters[threadId].value += work(index, 16);
+	}, 200000);
+	pool.wait();
+}
+
+// many small jobs, each waited for, measures submission and completion latency
+template <typename Pool>
+void manySmallJobs(Pool& pool, std::vector<Counter>& counters, unsigned int threadCount) {
+	for (int i = 0; i < 2000; i++) {
+		pool.addJob([&counters](int index, int threadId) {
+			counters[threadId].value += work(index, 256);
+		}, threadCount);
+		pool.wait();
+	}
+}
+
+// the same small jobs submitted as single ranges, each with one completion signal
+void manySmallLoops(ThreadPool& pool, std::vector<Counter>& counters, unsigned int threadCount) {
+	for (int i = 0; i < 2000; i++) {
+		pool.parallelFor(0, threadCount, 1, [&counters](int index, int threadId) {
+			counters[threadId].value += work(index, 256);
+		});
+	}
+}
+
+// repeats with very different costs, the work has to be rebalanced between threads
+template <typename Pool>
+void uneven(Pool& pool, std::vector<Counter>& counters) {
+	pool.addJob([&counters](int index, int threadId) {
+		counters[threadId].value += work(index, (index % 64 == 0) ? 200000 : 100);
+	}, 4096);
+	pool.wait();
+}
+
+// returns a row of the result table
+template <typename Pool>
+std::string benchmark(const char* name, unsigned int threadCount) {
+	Pool pool(threadCount);
+	std::vector<Counter> counters(threadCount);
+
+	auto measure = [](const auto& function) {
+		double best = 1e30;
+		for (int i = 0; i < REPEATS; i++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			function();
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	};
+
+	const double fineGrainedTime = measure([&]() { fineGrained(pool, counters); });
+	const double manySmallJobsTime = measure([&]() { manySmallJobs(pool, counters, threadCount); });
+	const double unevenTime = measure([&]() { uneven(pool, counters); });
+
+	std::stringstream row;
+	row << std::setw(14) << name << std::setw(9) << threadCount << std::fixed << std::setprecision(2)
+		<< std::setw(16) << fineGrainedTime << std::setw(16) << manySmallJobsTime << std::setw(16) << unevenTime;
+	if constexpr (std::is_same_v<Pool, ThreadPool>) {
+		row << std::setw(16) << measure([&]() { manySmallLoops(pool, counters, threadCount); });
+	}
+	else {
+		row << std::setw(16) << "-";
+	}
+	row << " ms\n";
+	return row.str();
+}
+
+int main() {
+	std::vector<unsigned int> threadCounts = { 2, 4 };
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 4) {
+		threadCounts.push_back(hardwareThreads);
+	}
+
+	std::vector<std::string> rows;
+	for (unsigned int threadCount : threadCounts) {
+		rows.push_back(benchmark<QueueThreadPool>("queue", threadCount));
+		rows.push_back(benchmark<ThreadPool>("work-stealing", threadCount));
+	}
+
+	std::cout << "\nbest of " << REPEATS << " runs\n";
+	std::cout << std::setw(14) << "pool" << std::setw(9) << "threads" << std::setw(16) << "fine grained" << std::setw(16) << "small jobs" << std::setw(16) << "uneven" << std::setw(16) << "small loops" << '\n';
+	for (const std::string& row : rows) {
+		std::cout << row;
+	}
+	return 0;
+}
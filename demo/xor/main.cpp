@@ -14,9 +14,10 @@ std::array<TrainingData, 4> trainingData = { {
 } };
 
 int main() {
-	srand(time(NULL));
+	seedThreadRandom(time(NULL));
 
-	Network network({ 2, 3, 1 });
+	// samples are trained one at a time on the calling thread, so no workers are started
+	Network network({ 2, 3, 1 }, 32, 1);
 	network.setLearningRate(1.0f);
 
 	for (int iteration = 0; iteration < 4000; iteration++) {
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+
+#include "Matrix.hpp"
+
+enum class Activation {
+	Sigmoid,
+	ReLU,
+	LeakyReLU,
+	Tanh,
+	// normalizes every sample (column) of the layer into a probability distribution
+	Softmax
+};
+
+constexpr float leakyReluSlope = 0.01f;
+
+// destination = activation(source) for size values of an element-wise activation
+void applyActivation(Activation activation, const float* source, float* destination, unsigned int size) {
+	switch (activation) {
+	case Activation::Sigmoid:
+		kernels::get().sigmoid(destination, source, size);
+		break;
+	case Activation::ReLU:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] = std::max(source[i], 0.0f);
+		}
+		break;
+	case Activation::LeakyReLU:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] = (source[i] > 0.0f) ? source[i] : source[i] * leakyReluSlope;
+		}
+		break;
+	case Activation::Tanh:
+		// tanh(x) = 2 * sigmoid(2x) - 1
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] = source[i] * 2.0f;
+		}
+		kernels::get().sigmoid(destination, destination, size);
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] = destination[i] * 2.0f - 1.0f;
+		}
+		break;
+	case Activation::Softmax:
+		throw std::invalid_argument("Softmax is not an element-wise activation");
+	}
+}
+
+// outputs = activation(inputs), every column of the views is one sample
+// element-wise activations are applied to the contiguous runs of the views, so ranges of neurons work as well as whole layers
+void applyActivation(Activation activation, const MatrixView2D<float>& inputs, const MatrixView2D<float>& outputs) {
+	if (activation != Activation::Softmax) {
+		outputs.forEachRun(inputs, [activation](float* destination, const float* source, unsigned int size) {
+			applyActivation(activation, source, destination, size);
+		});
+		return;
+	}
+
+	for (unsigned int iSample = 0; iSample < outputs.getDimension(1); iSample++) {
+		const float* sampleInputs = inputs.dataAt(0, iSample);
+		float* sampleOutputs = outputs.dataAt(0, iSample);
+		const unsigned int neuronCount = outputs.getDimension(0);
+
+		// shifting by the maximum keeps exp from overflowing
+		const float maxInput = *std::max_element(sampleInputs, sampleInputs + neuronCount);
+		kernels::get().exp(sampleOutputs, sampleInputs, -maxInput, neuronCount);
+		float sum = 0.0f;
+		for (unsigned int i = 0; i < neuronCount; i++) {
+			sum += sampleOutputs[i];
+		}
+		kernels::get().scale(sampleOutputs, 1.0f / sum, neuronCount);
+	}
+}
+
+// destination *= derivative of an element-wise activation for size values, activated holds its outputs
+void applyActivationDerivative(Activation activation, const float* activated, float* destination, unsigned int size) {
+	switch (activation) {
+	case Activation::Sigmoid:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] *= activated[i] * (1.0f - activated[i]);
+		}
+		break;
+	case Activation::ReLU:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] = (activated[i] > 0.0f) ? destination[i] : 0.0f;
+		}
+		break;
+	case Activation::LeakyReLU:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] *= (activated[i] > 0.0f) ? 1.0f : leakyReluSlope;
+		}
+		break;
+	case Activation::Tanh:
+		for (unsigned int i = 0; i < size; i++) {
+			destination[i] *= 1.0f - activated[i] * activated[i];
+		}
+		break;
+	case Activation::Softmax:
+		throw std::invalid_argument("Softmax is not an element-wise activation");
+	}
+}
+
+// errors *= derivative of the activation, computed from the stored outputs instead of recomputing the activation
+void applyActivationDerivative(Activation activation, const MatrixView2D<float>& outputs, const MatrixView2D<float>& errors) {
+	if (activation != Activation::Softmax) {
+		errors.forEachRun(outputs, [activation](float* destination, const float* activated, unsigned int size) {
+			applyActivationDerivative(activation, activated, destination, size);
+		});
+		return;
+	}
+
+	// full Jacobian of softmax applied to the errors: y_i * (e_i - sum_j e_j * y_j)
+	for (unsigned int iSample = 0; iSample < errors.getDimension(1); iSample++) {
+		const float* sampleOutputs = outputs.dataAt(0, iSample);
+		float* sampleErrors = errors.dataAt(0, iSample);
+		const unsigned int neuronCount = errors.getDimension(0);
+
+		const float weightedSum = kernels::get().dot(sampleErrors, sampleOutputs, neuronCount);
+		for (unsigned int i = 0; i < neuronCount; i++) {
+			sampleErrors[i] = sampleOutputs[i] * (sampleErrors[i] - weightedSum);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// allocators used for Matrix storage, they only provide raw memory, construction is done by Matrix
+
+constexpr std::size_t cacheLineSize = 64;
+
+// number of values of type T rounded up to whole cache lines, so buffers written by different threads can be laid out
+// one after another without sharing a line
+template <typename T>
+constexpr unsigned int padToCacheLine(unsigned int count) {
+	constexpr unsigned int perLine = cacheLineSize / sizeof(T);
+	return (count + perLine - 1) / perLine * perLine;
+}
+
+// cache-line aligned memory, so vector loads never split across cache lines
+template <typename T, std::size_t alignment = cacheLineSize>
+struct AlignedAllocator {
+	static constexpr std::size_t getAlignment() {
+		return (alignment > alignof(T)) ? alignment : alignof(T);
+	}
+
+	T* allocate(std::size_t count) {
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(getAlignment())));
+	}
+
+	void deallocate(T* pointer, std::size_t) {
+		::operator delete(pointer, std::align_val_t(getAlignment()));
+	}
+};
+
+// buffers of at least hugePageSize are aligned to the huge page size and marked for transparent huge pages,
+// which reduces TLB misses when walking large weight matrices, smaller buffers are only cache-line aligned
+template <typename T>
+struct HugePageAllocator {
+	static constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+	T* allocate(std::size_t count) {
+		const std::size_t bytes = count * sizeof(T);
+		if (bytes < hugePageSize) {
+			return AlignedAllocator<T>().allocate(count);
+		}
+		void* pointer = ::operator new(bytes, std::align_val_t(hugePageSize));
+#ifdef __linux__
+		madvise(pointer, bytes, MADV_HUGEPAGE);
+#endif
+		return static_cast<T*>(pointer);
+	}
+
+	void deallocate(T* pointer, std::size_t count) {
+		if (count * sizeof(T) < hugePageSize) {
+			AlignedAllocator<T>().deallocate(pointer, count);
+		}
+		else {
+			::operator delete(pointer, std::align_val_t(hugePageSize));
+		}
+	}
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+#include "Network.hpp"
+
+// prepares batches of training samples on background threads while the previous batches train
+// batches are filled in place in a ring of preallocated buffers and handed out by reference, so Network::trainBatch reads
+// the buffer the loader filled without any copy
+class DataLoader {
+public:
+	// fills sample with the sample number sampleIndex, counted from 0 across all batches, is called on the loader threads,
+	// so it has to be safe to call from several threads at once
+	using PrepareFunction = std::function<void(TrainingData& sample, std::uint64_t sampleIndex)>;
+
+	// bufferCount - batches in the ring, at least 2, so one batch is prepared while the other one trains
+	// threadCount - threads preparing batches, every thread fills whole batches, more than bufferCount - 1 threads never all run
+	DataLoader(unsigned int inputSize, unsigned int outputSize, unsigned int batchSize, const PrepareFunction& prepare,
+		unsigned int bufferCount = 2, unsigned int threadCount = 1)
+		: prepare(prepare), batchSize(batchSize), buffers(std::max(bufferCount, 2u)) {
+		for (Buffer& buffer : buffers) {
+			buffer.samples.reserve(batchSize);
+			for (unsigned int i = 0; i < batchSize; i++) {
+				buffer.samples.emplace_back(inputSize, outputSize);
+			}
+		}
+		threads.reserve(threadCount);
+		for (unsigned int i = 0; i < std::max(threadCount, 1u); i++) {
+			threads.push_back(std::thread(&DataLoader::threadEntry, this));
+		}
+	}
+
+	DataLoader(const DataLoader&) = delete;
+	DataLoader& operator=(const DataLoader&) = delete;
+
+	// blocks until the next batch is prepared and returns it, batches come in order of their sample indices
+	// the batch stays valid until the next call, which hands its buffer back to be filled again
+	const std::vector<TrainingData>& next() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (nextBatch > 0) {
+			buffers[(nextBatch - 1) % buffers.size()].state = State::Free;
+			producerCondition.notify_all();
+		}
+
+		Buffer& buffer = buffers[nextBatch % buffers.size()];
+		consumerCondition.wait(lock, [this, &buffer]() { return buffer.state == State::Ready || error != nullptr; });
+		if (error != nullptr) {
+			std::rethrow_exception(error);
+		}
+		buffer.state = State::InUse;
+		nextBatch++;
+		return buffer.samples;
+	}
+
+	unsigned int getBatchSize() const {
+		return batchSize;
+	}
+
+	~DataLoader() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			terminate = true;
+		}
+		producerCondition.notify_all();
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+
+private:
+	enum class State {
+		Free,
+		Filling,
+		Ready,
+		InUse
+	};
+
+	struct Buffer {
+		std::vector<TrainingData> samples;
+		State state = State::Free;
+	};
+
+	PrepareFunction prepare;
+	unsigned int batchSize;
+	std::vector<Buffer> buffers;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	// producers wait for the buffer of the next batch to be handed back, the consumer for its batch to be ready
+	std::condition_variable producerCondition;
+	std::condition_variable consumerCondition;
+	// batch number filled next by a loader thread and returned next by next(), batch b always uses buffer b % buffers.size()
+	std::uint64_t nextFill = 0;
+	std::uint64_t nextBatch = 0;
+	// first exception thrown by prepare, rethrown by next()
+	std::exception_ptr error;
+	bool terminate = false;
+
+	void threadEntry() {
+		while (true) {
+			std::uint64_t batch;
+			Buffer* buffer;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				producerCondition.wait(lock, [this]() { return terminate || (error == nullptr && buffers[nextFill % buffers.size()].state == State::Free); });
+				if (terminate) {
+					return;
+				}
+				batch = nextFill++;
+				buffer = &buffers[batch % buffers.size()];
+				buffer->state = State::Filling;
+			}
+
+			try {
+				for (unsigned int i = 0; i < batchSize; i++) {
+					prepare(buffer->samples[i], batch * batchSize + i);
+				}
+			}
+			catch (...) {
+				std::unique_lock<std::mutex> lock(mutex);
+				error = std::current_exception();
+				consumerCondition.notify_all();
+				continue;
+			}
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				buffer->state = State::Ready;
+			}
+			consumerCondition.notify_all();
+		}
+	}
+};
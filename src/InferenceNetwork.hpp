@@ -0,0 +1,286 @@
+#pragma once
+
+#include <initializer_list>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Matrix.hpp"
+#include "Layer.hpp"
+#include "ThreadPool.hpp"
+
+// samples the first layer reads straight from the caller's memory, count samples of the input size of the network stored
+// one after another, either as floats or as bytes normalized to scale * byte + offset while the first layer reads them,
+// e.g. the images of a memory-mapped dataset, so no float copy of the inputs is made
+struct InputBatch {
+	const float* floats = nullptr;
+	const std::uint8_t* bytes = nullptr;
+	unsigned int count = 0;
+	float scale = 1.0f;
+	float offset = 0.0f;
+
+	InputBatch(const float* inputs, unsigned int count) : floats(inputs), count(count) {}
+	InputBatch(const std::uint8_t* inputs, unsigned int count, float scale = 1.0f / 255.0f, float offset = 0.0f)
+		: bytes(inputs), count(count), scale(scale), offset(offset) {}
+
+	// samples [first, first + count), size - values per sample
+	InputBatch slice(unsigned int first, unsigned int count, unsigned int size) const {
+		InputBatch result = *this;
+		if (floats != nullptr) {
+			result.floats = floats + (std::size_t)first * size;
+		}
+		else {
+			result.bytes = bytes + (std::size_t)first * size;
+		}
+		result.count = count;
+		return result;
+	}
+
+	// samples of float inputs as columns
+	MatrixView2D<float> getColumns(unsigned int size) const {
+		const unsigned int dimensions[2] = { size, count };
+		const unsigned int strides[2] = { 1, size };
+		return MatrixView2D<float>(const_cast<float*>(floats), dimensions, strides);
+	}
+
+	// samples of byte inputs as columns
+	ByteColumns getByteColumns(unsigned int size) const {
+		return { bytes, size, size, count, scale, offset };
+	}
+};
+
+// frozen network used only for predictions, keeps weights, biases and activations of every layer,
+// no gradient, error or batch buffers, activations are stored in a workspace owned by the caller
+class InferenceNetwork {
+public:
+	// copies the parameters of trained layers, see Network::freeze
+	InferenceNetwork(Layer* const* layers, int layerCount) : inputSize(layers[0]->getNeuronCount()) {
+		for (int iLayer = 1; iLayer < layerCount; iLayer++) {
+			this->layers.emplace_back(layers[iLayer - 1]->getWeights(), layers[iLayer]->getBiases(), layers[iLayer]->getActivation());
+		}
+		updateMaxLayerSize();
+	}
+
+	// loads a model saved by Network::save, activations have the same meaning as in the Network constructor
+	// as the model file does not store them
+	InferenceNetwork(const char* path, const std::initializer_list<Activation>& activations = {}) : inputSize(0) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error(std::string("Failed to open file ") + path);
+		}
+
+		int layerCount;
+		file.read((char*)&layerCount, sizeof(int));
+		if (activations.size() != 0 && activations.size() + 1 != (size_t)layerCount) {
+			throw std::invalid_argument("Activation count has to match the count of non-input layers");
+		}
+
+		Matrix2D<float, WeightAllocator> weights({ 0, 0 });
+		for (int iLayer = 0; iLayer < layerCount; iLayer++) {
+			int neuronCount;
+			file.read((char*)&neuronCount, sizeof(int));
+
+			int weightCount;
+			file.read((char*)&weightCount, sizeof(int));
+
+			Matrix1D<float> biases({ (unsigned int)neuronCount });
+			Matrix2D<float, WeightAllocator> nextWeights({ (unsigned int)neuronCount, (unsigned int)weightCount });
+			for (int iNeuron = 0; iNeuron < neuronCount; iNeuron++) {
+				file.read((char*)&biases(iNeuron), sizeof(float));
+				for (int iWeight = 0; iWeight < weightCount; iWeight++) {
+					file.read((char*)&nextWeights(iNeuron, iWeight), sizeof(float));
+				}
+			}
+
+			if (iLayer == 0) {
+				inputSize = neuronCount;
+			}
+			else {
+				const Activation activation = (activations.size() != 0) ? *(activations.begin() + iLayer - 1) : Activation::Sigmoid;
+				layers.emplace_back(std::move(weights), std::move(biases), activation);
+			}
+			weights = std::move(nextWeights);
+		}
+		if (!file) {
+			throw std::runtime_error(std::string("Failed to read model from ") + path);
+		}
+		updateMaxLayerSize();
+	}
+
+	// scratch activations of the samples propagated at once, grows to the widest layer of the networks it is used with
+	// every thread predicting at the same time needs its own workspace
+	class Workspace {
+	public:
+		Workspace(unsigned int size = 0) : columns{ Matrix1D<float>({ size }), Matrix1D<float>({ size }) } {}
+
+		void reserve(unsigned int size) {
+			if (columns[0].getSize() < size) {
+				columns[0] = Matrix1D<float>({ size });
+				columns[1] = Matrix1D<float>({ size });
+			}
+		}
+
+	private:
+		friend class InferenceNetwork;
+
+		// layers alternate between the two buffers, so each reads the outputs of the previous one
+		Matrix1D<float> columns[2];
+	};
+
+	// propagates a single sample, the network is only read, so any number of threads can predict at once
+	// as long as each of them uses a different workspace, outputs has to hold getOutputSize() floats
+	void predict(const float* inputs, float* outputs, Workspace& workspace) const {
+		predictSamples(InputBatch(inputs, 1), outputs, workspace);
+	}
+
+	// predicts with a workspace owned by the calling thread
+	void predict(const float* inputs, float* outputs) const {
+		predictSamples(InputBatch(inputs, 1), outputs, getThreadWorkspace());
+	}
+
+	// lowers the latency of a single sample by splitting the neurons of layers with at least getParallelLayerThreshold()
+	// weights across the workers of threadPool, has to be called from outside of the pool
+	void predict(const float* inputs, float* outputs, Workspace& workspace, ThreadPool& threadPool) const {
+		predictSamples(InputBatch(inputs, 1), outputs, workspace, &threadPool);
+	}
+
+	// inputs and outputs hold count samples one after another, getInputSize() and getOutputSize() floats each
+	// samples are propagated in chunks small enough for their activations to stay in cache, each layer of a chunk is a single
+	// matrix product, the chunks are spread over the workers of threadPool when one is given
+	void predictBatch(const float* inputs, unsigned int count, float* outputs, ThreadPool* threadPool = nullptr) const {
+		predictBatch(InputBatch(inputs, count), outputs, threadPool);
+	}
+
+	// predicts inputs read from the caller's memory, byte inputs are normalized inside the first layer's matrix product
+	void predictBatch(const InputBatch& inputs, float* outputs, ThreadPool* threadPool = nullptr) const {
+		const unsigned int count = inputs.count;
+		const unsigned int chunkSize = getChunkSize();
+		const unsigned int chunkCount = (count + chunkSize - 1) / chunkSize;
+		const unsigned int outputSize = getOutputSize();
+
+		auto predictChunk = [&](int iChunk, int) {
+			const unsigned int first = iChunk * chunkSize;
+			predictSamples(inputs.slice(first, std::min(chunkSize, count - first), inputSize), outputs + first * outputSize, getThreadWorkspace());
+		};
+
+		if (threadPool != nullptr && chunkCount == 1) {
+			// too few samples to spread, the layers are split instead
+			predictSamples(inputs, outputs, getThreadWorkspace(), threadPool);
+		}
+		else if (threadPool == nullptr) {
+			for (unsigned int iChunk = 0; iChunk < chunkCount; iChunk++) {
+				predictChunk(iChunk, 0);
+			}
+		}
+		else {
+			// chunks are large enough to be stolen one by one
+			threadPool->parallelFor(0, chunkCount, 1, predictChunk);
+		}
+	}
+
+	// workspace large enough for single sample predictions of this network, so predict does not allocate
+	Workspace createWorkspace() const {
+		return Workspace(maxLayerSize);
+	}
+
+	unsigned int getInputSize() const {
+		return inputSize;
+	}
+
+	unsigned int getOutputSize() const {
+		return layers.empty() ? inputSize : layers.back().biases.getSize();
+	}
+
+	// number of layers including the input one, as in Network
+	int getLayerCount() const {
+		return layers.size() + 1;
+	}
+
+	// weights a layer needs to be split across the workers of the pool a single sample or small batch is predicted with
+	void setParallelLayerThreshold(unsigned int parallelLayerThreshold) {
+		this->parallelLayerThreshold = parallelLayerThreshold;
+	}
+
+	unsigned int getParallelLayerThreshold() const {
+		return parallelLayerThreshold;
+	}
+
+	// number of samples predicted at once by predictBatch, so the inputs and activations of a chunk fit in a typical L2 cache
+	unsigned int getChunkSize() const {
+		constexpr unsigned int chunkBytes = 256 * 1024;
+		const unsigned int sampleBytes = (inputSize + 2 * maxLayerSize) * sizeof(float);
+		// multiple of the column block of the matrix product kernel
+		return std::max(chunkBytes / std::max(sampleBytes, 1u) / 4 * 4, 4u);
+	}
+
+private:
+	// weights connect the previous layer to this one, biases and activation belong to this layer
+	struct InferenceLayer {
+		Matrix2D<float, WeightAllocator> weights;
+		Matrix1D<float> biases;
+		Activation activation;
+
+		InferenceLayer(const Matrix2D<float, WeightAllocator>& weights, const Matrix1D<float>& biases, Activation activation)
+			: weights(weights), biases(biases), activation(activation) {}
+		InferenceLayer(Matrix2D<float, WeightAllocator>&& weights, Matrix1D<float>&& biases, Activation activation)
+			: weights(std::move(weights)), biases(std::move(biases)), activation(activation) {}
+	};
+
+	std::vector<InferenceLayer> layers;
+	unsigned int inputSize;
+
+	unsigned int maxLayerSize = 0;
+	unsigned int parallelLayerThreshold = defaultParallelLayerThreshold;
+
+	void updateMaxLayerSize() {
+		for (const InferenceLayer& layer : layers) {
+			maxLayerSize = std::max(maxLayerSize, layer.biases.getSize());
+		}
+	}
+
+	// large layers are split across the workers of threadPool when one is given
+	void predictSamples(const InputBatch& inputs, float* outputs, Workspace& workspace, ThreadPool* threadPool = nullptr) const {
+		const unsigned int count = inputs.count;
+		if (layers.empty()) {
+			for (unsigned int i = 0; i < inputSize * count; i++) {
+				outputs[i] = (inputs.floats != nullptr) ? inputs.floats[i] : inputs.scale * inputs.bytes[i] + inputs.offset;
+			}
+			return;
+		}
+		workspace.reserve(maxLayerSize * count);
+		MatrixView2D<float> previous = inputs.getColumns(inputSize);
+		for (unsigned int iLayer = 0; iLayer < layers.size(); iLayer++) {
+			const InferenceLayer& layer = layers[iLayer];
+			// the last layer writes straight to the caller's buffer
+			float* data = (iLayer + 1 == layers.size()) ? outputs : workspace.columns[iLayer % 2].getData();
+			const MatrixView2D<float> current = getColumns(data, layer.biases.getSize(), count);
+			if (iLayer == 0 && inputs.bytes != nullptr) {
+				// not split, every range would normalize all of the bytes again
+				multiplyAndAdd(layer.weights, inputs.getByteColumns(inputSize), layer.biases, current);
+				applyActivation(layer.activation, current, current);
+			}
+			else if (threadPool != nullptr && threadPool->getThreadCount() > 1 && layer.weights.getSize() >= parallelLayerThreshold) {
+				propagateParallel(*threadPool, layer.weights, previous, layer.biases, layer.activation, current, current);
+			}
+			else {
+				multiplyAndAdd(layer.weights, previous, layer.biases, current);
+				applyActivation(layer.activation, current, current);
+			}
+			previous = current;
+		}
+	}
+
+	static Workspace& getThreadWorkspace() {
+		thread_local Workspace workspace;
+		return workspace;
+	}
+
+	// view of count samples of size floats stored one after another
+	static MatrixView2D<float> getColumns(float* data, unsigned int size, unsigned int count) {
+		const unsigned int dimensions[2] = { size, count };
+		const unsigned int strides[2] = { 1, size };
+		return MatrixView2D<float>(data, dimensions, strides);
+	}
+};
@@ -0,0 +1,965 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+// SIMD implementations of the float primitives used by Matrix, selected at startup from the CPU features,
+// so one binary runs on every x86 machine with the widest instruction set it supports
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KERNELS_TARGET_SSE __attribute__((target("sse2")))
+#define KERNELS_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define KERNELS_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma")))
+#else
+#define KERNELS_TARGET_SSE
+#define KERNELS_TARGET_AVX2
+#define KERNELS_TARGET_AVX512
+#endif
+
+namespace kernels {
+	enum class Level {
+		Scalar,
+		SSE,
+		AVX2,
+		AVX512
+	};
+
+	struct KernelTable {
+		Level level;
+		// returns sum of a[i] * b[i]
+		float (*dot)(const float* a, const float* b, unsigned int size);
+		// result(r, k) = c[r] + sum of a[r * aStride + j] * b[k * bStride + j], for rows, columns <= 4, c may be nullptr
+		void (*multiplyAndAddTile)(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth, unsigned int rows, unsigned int columns);
+		void (*add)(float* destination, const float* source, unsigned int size);
+		void (*subtract)(float* destination, const float* source, unsigned int size);
+		void (*scale)(float* destination, float scalar, unsigned int size);
+		// destination[i] = 1 / (1 + exp(-source[i]))
+		void (*sigmoid)(float* destination, const float* source, unsigned int size);
+		// destination[i] = exp(source[i] + offset)
+		void (*exp)(float* destination, const float* source, float offset, unsigned int size);
+		// destination[k * destinationStride + i] += scalars[k * scalarStride] * source[i], for k < columns
+		void (*addScaledToColumns)(float* destination, unsigned int destinationStride, const float* source, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size);
+		// destination[i] += sum of scalars[k * scalarStride] * source[k * sourceStride + i], for k < columns
+		void (*addScaledColumns)(float* destination, const float* source, unsigned int sourceStride, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size);
+		// optimizer steps, gradients point in the direction the parameters are moved
+		// velocity = momentum * velocity + learningRate * gradients, parameters += velocity
+		void (*momentumStep)(float* parameters, float* velocity, const float* gradients, float learningRate, float momentum, unsigned int size);
+		// meanSquares = decay * meanSquares + (1 - decay) * gradients^2, parameters += learningRate * gradients / (sqrt(meanSquares) + epsilon)
+		void (*rmsPropStep)(float* parameters, float* meanSquares, const float* gradients, float learningRate, float decay, float epsilon, unsigned int size);
+		// means = beta1 * means + (1 - beta1) * gradients, variances = beta2 * variances + (1 - beta2) * gradients^2,
+		// parameters += learningRate * means / (sqrt(variances) + epsilon)
+		void (*adamStep)(float* parameters, float* means, float* variances, const float* gradients, float learningRate, float beta1, float beta2, float epsilon, unsigned int size);
+	};
+
+	namespace scalar {
+		inline float dot(const float* a, const float* b, unsigned int size) {
+			float sum = 0.0f;
+			for (unsigned int i = 0; i < size; i++) {
+				sum += a[i] * b[i];
+			}
+			return sum;
+		}
+
+		inline void multiplyAndAddTile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth, unsigned int rows, unsigned int columns) {
+			for (unsigned int k = 0; k < columns; k++) {
+				for (unsigned int r = 0; r < rows; r++) {
+					result[k * resultStride + r] = (c != nullptr ? c[r] : 0.0f) + dot(a + r * aStride, b + k * bStride, depth);
+				}
+			}
+		}
+
+		inline void add(float* destination, const float* source, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				destination[i] += source[i];
+			}
+		}
+
+		inline void subtract(float* destination, const float* source, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				destination[i] -= source[i];
+			}
+		}
+
+		inline void scale(float* destination, float scalar, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				destination[i] *= scalar;
+			}
+		}
+
+		inline void sigmoid(float* destination, const float* source, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				destination[i] = 1.0f / (1.0f + std::exp(-source[i]));
+			}
+		}
+
+		inline void exp(float* destination, const float* source, float offset, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				destination[i] = std::exp(source[i] + offset);
+			}
+		}
+
+		inline void addScaledToColumns(float* destination, unsigned int destinationStride, const float* source, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			for (unsigned int k = 0; k < columns; k++) {
+				const float scalar = scalars[k * scalarStride];
+				float* column = destination + k * destinationStride;
+				for (unsigned int i = 0; i < size; i++) {
+					column[i] += scalar * source[i];
+				}
+			}
+		}
+
+		inline void addScaledColumns(float* destination, const float* source, unsigned int sourceStride, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				float sum = destination[i];
+				for (unsigned int k = 0; k < columns; k++) {
+					sum += scalars[k * scalarStride] * source[k * sourceStride + i];
+				}
+				destination[i] = sum;
+			}
+		}
+
+		inline void momentumStep(float* parameters, float* velocity, const float* gradients, float learningRate, float momentum, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				velocity[i] = momentum * velocity[i] + learningRate * gradients[i];
+				parameters[i] += velocity[i];
+			}
+		}
+
+		inline void rmsPropStep(float* parameters, float* meanSquares, const float* gradients, float learningRate, float decay, float epsilon, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				meanSquares[i] = decay * meanSquares[i] + (1.0f - decay) * gradients[i] * gradients[i];
+				parameters[i] += learningRate * gradients[i] / (std::sqrt(meanSquares[i]) + epsilon);
+			}
+		}
+
+		inline void adamStep(float* parameters, float* means, float* variances, const float* gradients, float learningRate, float beta1, float beta2, float epsilon, unsigned int size) {
+			for (unsigned int i = 0; i < size; i++) {
+				means[i] = beta1 * means[i] + (1.0f - beta1) * gradients[i];
+				variances[i] = beta2 * variances[i] + (1.0f - beta2) * gradients[i] * gradients[i];
+				parameters[i] += learningRate * means[i] / (std::sqrt(variances[i]) + epsilon);
+			}
+		}
+	}
+
+	// exp approximation constants (Cephes expf)
+	constexpr float expHigh = 88.3762626647949f;
+	constexpr float expLow = -88.3762626647949f;
+	constexpr float log2e = 1.44269504088896341f;
+	constexpr float expC1 = 0.693359375f;
+	constexpr float expC2 = -2.12194440e-4f;
+	constexpr float expP0 = 1.9875691500e-4f;
+	constexpr float expP1 = 1.3981999507e-3f;
+	constexpr float expP2 = 8.3334519073e-3f;
+	constexpr float expP3 = 4.1665795894e-2f;
+	constexpr float expP4 = 1.6666665459e-1f;
+	constexpr float expP5 = 5.0000001201e-1f;
+
+	// the exp approximation of the vector kernels in plain arithmetic, for loops with a trip count known at compile time,
+	// which the compiler vectorizes on its own, e.g. in StaticNetwork
+	inline float expApproximation(float x) {
+		// adding and removing 1.5 * 2^23 rounds to the nearest integer like the conversion in the vector kernels
+		constexpr float roundingShift = 12582912.0f;
+		x = std::min(std::max(x, expLow), expHigh);
+		const float fn = (x * log2e + roundingShift) - roundingShift;
+		x = x - fn * expC1;
+		x = x - fn * expC2;
+		float y = expP0;
+		y = y * x + expP1;
+		y = y * x + expP2;
+		y = y * x + expP3;
+		y = y * x + expP4;
+		y = y * x + expP5;
+		y = y * (x * x) + x + 1.0f;
+		return y * std::bit_cast<float>(((std::int32_t)fn + 127) << 23);
+	}
+
+#ifdef KERNELS_X86
+	namespace sse {
+		KERNELS_TARGET_SSE inline float horizontalSum(__m128 v) {
+			__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 sums = _mm_add_ps(v, shuffled);
+			shuffled = _mm_movehl_ps(shuffled, sums);
+			sums = _mm_add_ss(sums, shuffled);
+			return _mm_cvtss_f32(sums);
+		}
+
+		KERNELS_TARGET_SSE inline __m128 exp(__m128 x) {
+			x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(expLow)), _mm_set1_ps(expHigh));
+			__m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(log2e)));
+			__m128 fn = _mm_cvtepi32_ps(n);
+			x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(expC1)));
+			x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(expC2)));
+			__m128 y = _mm_set1_ps(expP0);
+			y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP1));
+			y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP2));
+			y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP3));
+			y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP4));
+			y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(expP5));
+			y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x), _mm_set1_ps(1.0f));
+			__m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+			return _mm_mul_ps(y, pow2n);
+		}
+
+		KERNELS_TARGET_SSE inline float dot(const float* a, const float* b, unsigned int size) {
+			__m128 sum0 = _mm_setzero_ps();
+			__m128 sum1 = _mm_setzero_ps();
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+				sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+			}
+			float sum = horizontalSum(_mm_add_ps(sum0, sum1));
+			for (; i < size; i++) {
+				sum += a[i] * b[i];
+			}
+			return sum;
+		}
+
+		template <unsigned int rows, unsigned int columns>
+		KERNELS_TARGET_SSE inline void tile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth) {
+			__m128 sums[rows][columns];
+			for (unsigned int r = 0; r < rows; r++) {
+				for (unsigned int k = 0; k < columns; k++) {
+					sums[r][k] = _mm_setzero_ps();
+				}
+			}
+			unsigned int j = 0;
+			for (; j + 4 <= depth; j += 4) {
+				__m128 aValues[rows];
+				for (unsigned int r = 0; r < rows; r++) {
+					aValues[r] = _mm_loadu_ps(a + r * aStride + j);
+				}
+				for (unsigned int k = 0; k < columns; k++) {
+					const __m128 bValues = _mm_loadu_ps(b + k * bStride + j);
+					for (unsigned int r = 0; r < rows; r++) {
+						sums[r][k] = _mm_add_ps(sums[r][k], _mm_mul_ps(aValues[r], bValues));
+					}
+				}
+			}
+			for (unsigned int k = 0; k < columns; k++) {
+				for (unsigned int r = 0; r < rows; r++) {
+					float sum = (c != nullptr ? c[r] : 0.0f) + horizontalSum(sums[r][k]);
+					for (unsigned int jj = j; jj < depth; jj++) {
+						sum += a[r * aStride + jj] * b[k * bStride + jj];
+					}
+					result[k * resultStride + r] = sum;
+				}
+			}
+		}
+
+		KERNELS_TARGET_SSE inline void multiplyAndAddTile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth, unsigned int rows, unsigned int columns) {
+			if (rows == 4 && columns == 4) {
+				// two passes of 4x2, so the accumulators fit in the 16 vector registers
+				tile<4, 2>(a, aStride, b, bStride, c, result, resultStride, depth);
+				tile<4, 2>(a, aStride, b + 2 * bStride, bStride, c, result + 2 * resultStride, resultStride, depth);
+			}
+			else if (rows == 4 && columns == 1) {
+				tile<4, 1>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else if (rows == 1 && columns == 4) {
+				tile<1, 4>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else {
+				for (unsigned int k = 0; k < columns; k++) {
+					for (unsigned int r = 0; r < rows; r++) {
+						result[k * resultStride + r] = (c != nullptr ? c[r] : 0.0f) + dot(a + r * aStride, b + k * bStride, depth);
+					}
+				}
+			}
+		}
+
+		KERNELS_TARGET_SSE inline void add(float* destination, const float* source, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				_mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), _mm_loadu_ps(source + i)));
+			}
+			scalar::add(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void subtract(float* destination, const float* source, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				_mm_storeu_ps(destination + i, _mm_sub_ps(_mm_loadu_ps(destination + i), _mm_loadu_ps(source + i)));
+			}
+			scalar::subtract(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void scale(float* destination, float scalar, unsigned int size) {
+			const __m128 factor = _mm_set1_ps(scalar);
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				_mm_storeu_ps(destination + i, _mm_mul_ps(_mm_loadu_ps(destination + i), factor));
+			}
+			scalar::scale(destination + i, scalar, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void sigmoid(float* destination, const float* source, unsigned int size) {
+			const __m128 one = _mm_set1_ps(1.0f);
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				const __m128 e = exp(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(source + i)));
+				_mm_storeu_ps(destination + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+			}
+			scalar::sigmoid(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void exp(float* destination, const float* source, float offset, unsigned int size) {
+			const __m128 shift = _mm_set1_ps(offset);
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				_mm_storeu_ps(destination + i, exp(_mm_add_ps(_mm_loadu_ps(source + i), shift)));
+			}
+			scalar::exp(destination + i, source + i, offset, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void addScaledToColumns(float* destination, unsigned int destinationStride, const float* source, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				const __m128 values = _mm_loadu_ps(source + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					float* column = destination + k * destinationStride + i;
+					_mm_storeu_ps(column, _mm_add_ps(_mm_loadu_ps(column), _mm_mul_ps(_mm_set1_ps(scalars[k * scalarStride]), values)));
+				}
+			}
+			scalar::addScaledToColumns(destination + i, destinationStride, source + i, scalars, scalarStride, columns, size - i);
+		}
+
+		KERNELS_TARGET_SSE inline void addScaledColumns(float* destination, const float* source, unsigned int sourceStride, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 4 <= size; i += 4) {
+				__m128 sum = _mm_loadu_ps(destination + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(scalars[k * scalarStride]), _mm_loadu_ps(source + k * sourceStride + i)));
+				}
+				_mm_storeu_ps(destination + i, sum);
+			}
+			scalar::addScaledColumns(destination + i, source + i, sourceStride, scalars, scalarStride, columns, size - i);
+		}
+	}
+
+	namespace avx2 {
+		KERNELS_TARGET_AVX2 inline float horizontalSum(__m256 v) {
+			return sse::horizontalSum(_mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1)));
+		}
+
+		KERNELS_TARGET_AVX2 inline __m256 exp(__m256 x) {
+			x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(expLow)), _mm256_set1_ps(expHigh));
+			const __m256 fn = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			x = _mm256_fnmadd_ps(fn, _mm256_set1_ps(expC1), x);
+			x = _mm256_fnmadd_ps(fn, _mm256_set1_ps(expC2), x);
+			__m256 y = _mm256_set1_ps(expP0);
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(expP1));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(expP2));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(expP3));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(expP4));
+			y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(expP5));
+			y = _mm256_add_ps(_mm256_fmadd_ps(y, _mm256_mul_ps(x, x), x), _mm256_set1_ps(1.0f));
+			const __m256i n = _mm256_cvtps_epi32(fn);
+			const __m256 pow2n = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23));
+			return _mm256_mul_ps(y, pow2n);
+		}
+
+		KERNELS_TARGET_AVX2 inline float dot(const float* a, const float* b, unsigned int size) {
+			__m256 sum0 = _mm256_setzero_ps();
+			__m256 sum1 = _mm256_setzero_ps();
+			unsigned int i = 0;
+			for (; i + 16 <= size; i += 16) {
+				sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+				sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+			}
+			for (; i + 8 <= size; i += 8) {
+				sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+			}
+			float sum = horizontalSum(_mm256_add_ps(sum0, sum1));
+			for (; i < size; i++) {
+				sum += a[i] * b[i];
+			}
+			return sum;
+		}
+
+		template <unsigned int rows, unsigned int columns>
+		KERNELS_TARGET_AVX2 inline void tile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth) {
+			__m256 sums[rows][columns];
+			for (unsigned int r = 0; r < rows; r++) {
+				for (unsigned int k = 0; k < columns; k++) {
+					sums[r][k] = _mm256_setzero_ps();
+				}
+			}
+			unsigned int j = 0;
+			for (; j + 8 <= depth; j += 8) {
+				__m256 aValues[rows];
+				for (unsigned int r = 0; r < rows; r++) {
+					aValues[r] = _mm256_loadu_ps(a + r * aStride + j);
+				}
+				for (unsigned int k = 0; k < columns; k++) {
+					const __m256 bValues = _mm256_loadu_ps(b + k * bStride + j);
+					for (unsigned int r = 0; r < rows; r++) {
+						sums[r][k] = _mm256_fmadd_ps(aValues[r], bValues, sums[r][k]);
+					}
+				}
+			}
+			for (unsigned int k = 0; k < columns; k++) {
+				for (unsigned int r = 0; r < rows; r++) {
+					float sum = (c != nullptr ? c[r] : 0.0f) + horizontalSum(sums[r][k]);
+					for (unsigned int jj = j; jj < depth; jj++) {
+						sum += a[r * aStride + jj] * b[k * bStride + jj];
+					}
+					result[k * resultStride + r] = sum;
+				}
+			}
+		}
+
+		KERNELS_TARGET_AVX2 inline void multiplyAndAddTile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth, unsigned int rows, unsigned int columns) {
+			if (rows == 4 && columns == 4) {
+				// two passes of 4x2, so the accumulators fit in the 16 vector registers
+				tile<4, 2>(a, aStride, b, bStride, c, result, resultStride, depth);
+				tile<4, 2>(a, aStride, b + 2 * bStride, bStride, c, result + 2 * resultStride, resultStride, depth);
+			}
+			else if (rows == 4 && columns == 1) {
+				tile<4, 1>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else if (rows == 1 && columns == 4) {
+				tile<1, 4>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else {
+				for (unsigned int k = 0; k < columns; k++) {
+					for (unsigned int r = 0; r < rows; r++) {
+						result[k * resultStride + r] = (c != nullptr ? c[r] : 0.0f) + dot(a + r * aStride, b + k * bStride, depth);
+					}
+				}
+			}
+		}
+
+		KERNELS_TARGET_AVX2 inline void add(float* destination, const float* source, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				_mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), _mm256_loadu_ps(source + i)));
+			}
+			scalar::add(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void subtract(float* destination, const float* source, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				_mm256_storeu_ps(destination + i, _mm256_sub_ps(_mm256_loadu_ps(destination + i), _mm256_loadu_ps(source + i)));
+			}
+			scalar::subtract(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void scale(float* destination, float scalar, unsigned int size) {
+			const __m256 factor = _mm256_set1_ps(scalar);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				_mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_loadu_ps(destination + i), factor));
+			}
+			scalar::scale(destination + i, scalar, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void sigmoid(float* destination, const float* source, unsigned int size) {
+			const __m256 one = _mm256_set1_ps(1.0f);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				const __m256 e = exp(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(source + i)));
+				_mm256_storeu_ps(destination + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+			}
+			scalar::sigmoid(destination + i, source + i, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void exp(float* destination, const float* source, float offset, unsigned int size) {
+			const __m256 shift = _mm256_set1_ps(offset);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				_mm256_storeu_ps(destination + i, exp(_mm256_add_ps(_mm256_loadu_ps(source + i), shift)));
+			}
+			scalar::exp(destination + i, source + i, offset, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void addScaledToColumns(float* destination, unsigned int destinationStride, const float* source, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				const __m256 values = _mm256_loadu_ps(source + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					float* column = destination + k * destinationStride + i;
+					_mm256_storeu_ps(column, _mm256_fmadd_ps(_mm256_set1_ps(scalars[k * scalarStride]), values, _mm256_loadu_ps(column)));
+				}
+			}
+			scalar::addScaledToColumns(destination + i, destinationStride, source + i, scalars, scalarStride, columns, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void addScaledColumns(float* destination, const float* source, unsigned int sourceStride, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				__m256 sum = _mm256_loadu_ps(destination + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					sum = _mm256_fmadd_ps(_mm256_set1_ps(scalars[k * scalarStride]), _mm256_loadu_ps(source + k * sourceStride + i), sum);
+				}
+				_mm256_storeu_ps(destination + i, sum);
+			}
+			scalar::addScaledColumns(destination + i, source + i, sourceStride, scalars, scalarStride, columns, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void momentumStep(float* parameters, float* velocity, const float* gradients, float learningRate, float momentum, unsigned int size) {
+			const __m256 rate = _mm256_set1_ps(learningRate);
+			const __m256 factor = _mm256_set1_ps(momentum);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				const __m256 v = _mm256_fmadd_ps(factor, _mm256_loadu_ps(velocity + i), _mm256_mul_ps(rate, _mm256_loadu_ps(gradients + i)));
+				_mm256_storeu_ps(velocity + i, v);
+				_mm256_storeu_ps(parameters + i, _mm256_add_ps(_mm256_loadu_ps(parameters + i), v));
+			}
+			scalar::momentumStep(parameters + i, velocity + i, gradients + i, learningRate, momentum, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void rmsPropStep(float* parameters, float* meanSquares, const float* gradients, float learningRate, float decay, float epsilon, unsigned int size) {
+			const __m256 rate = _mm256_set1_ps(learningRate);
+			const __m256 factor = _mm256_set1_ps(decay);
+			const __m256 complement = _mm256_set1_ps(1.0f - decay);
+			const __m256 eps = _mm256_set1_ps(epsilon);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				const __m256 g = _mm256_loadu_ps(gradients + i);
+				const __m256 s = _mm256_fmadd_ps(factor, _mm256_loadu_ps(meanSquares + i), _mm256_mul_ps(complement, _mm256_mul_ps(g, g)));
+				_mm256_storeu_ps(meanSquares + i, s);
+				const __m256 step = _mm256_div_ps(_mm256_mul_ps(rate, g), _mm256_add_ps(_mm256_sqrt_ps(s), eps));
+				_mm256_storeu_ps(parameters + i, _mm256_add_ps(_mm256_loadu_ps(parameters + i), step));
+			}
+			scalar::rmsPropStep(parameters + i, meanSquares + i, gradients + i, learningRate, decay, epsilon, size - i);
+		}
+
+		KERNELS_TARGET_AVX2 inline void adamStep(float* parameters, float* means, float* variances, const float* gradients, float learningRate, float beta1, float beta2, float epsilon, unsigned int size) {
+			const __m256 rate = _mm256_set1_ps(learningRate);
+			const __m256 b1 = _mm256_set1_ps(beta1);
+			const __m256 b1Complement = _mm256_set1_ps(1.0f - beta1);
+			const __m256 b2 = _mm256_set1_ps(beta2);
+			const __m256 b2Complement = _mm256_set1_ps(1.0f - beta2);
+			const __m256 eps = _mm256_set1_ps(epsilon);
+			unsigned int i = 0;
+			for (; i + 8 <= size; i += 8) {
+				const __m256 g = _mm256_loadu_ps(gradients + i);
+				const __m256 m = _mm256_fmadd_ps(b1, _mm256_loadu_ps(means + i), _mm256_mul_ps(b1Complement, g));
+				const __m256 v = _mm256_fmadd_ps(b2, _mm256_loadu_ps(variances + i), _mm256_mul_ps(b2Complement, _mm256_mul_ps(g, g)));
+				_mm256_storeu_ps(means + i, m);
+				_mm256_storeu_ps(variances + i, v);
+				const __m256 step = _mm256_div_ps(_mm256_mul_ps(rate, m), _mm256_add_ps(_mm256_sqrt_ps(v), eps));
+				_mm256_storeu_ps(parameters + i, _mm256_add_ps(_mm256_loadu_ps(parameters + i), step));
+			}
+			scalar::adamStep(parameters + i, means + i, variances + i, gradients + i, learningRate, beta1, beta2, epsilon, size - i);
+		}
+	}
+
+	namespace avx512 {
+		KERNELS_TARGET_AVX512 inline __m512 exp(__m512 x) {
+			x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(expLow)), _mm512_set1_ps(expHigh));
+			const __m512 fn = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+			x = _mm512_fnmadd_ps(fn, _mm512_set1_ps(expC1), x);
+			x = _mm512_fnmadd_ps(fn, _mm512_set1_ps(expC2), x);
+			__m512 y = _mm512_set1_ps(expP0);
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(expP1));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(expP2));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(expP3));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(expP4));
+			y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(expP5));
+			y = _mm512_add_ps(_mm512_fmadd_ps(y, _mm512_mul_ps(x, x), x), _mm512_set1_ps(1.0f));
+			const __m512i n = _mm512_cvtps_epi32(fn);
+			const __m512 pow2n = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(n, _mm512_set1_epi32(127)), 23));
+			return _mm512_mul_ps(y, pow2n);
+		}
+
+		KERNELS_TARGET_AVX512 inline float dot(const float* a, const float* b, unsigned int size) {
+			__m512 sum0 = _mm512_setzero_ps();
+			__m512 sum1 = _mm512_setzero_ps();
+			unsigned int i = 0;
+			for (; i + 32 <= size; i += 32) {
+				sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+				sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), sum1);
+			}
+			if (i + 16 <= size) {
+				sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+				i += 16;
+			}
+			if (i < size) {
+				const __mmask16 mask = (__mmask16)((1u << (size - i)) - 1);
+				sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), sum1);
+			}
+			return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+		}
+
+		template <unsigned int rows, unsigned int columns>
+		KERNELS_TARGET_AVX512 inline void tile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth) {
+			__m512 sums[rows][columns];
+			for (unsigned int r = 0; r < rows; r++) {
+				for (unsigned int k = 0; k < columns; k++) {
+					sums[r][k] = _mm512_setzero_ps();
+				}
+			}
+			for (unsigned int j = 0; j < depth; j += 16) {
+				const __mmask16 mask = (depth - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (depth - j)) - 1);
+				__m512 aValues[rows];
+				for (unsigned int r = 0; r < rows; r++) {
+					aValues[r] = _mm512_maskz_loadu_ps(mask, a + r * aStride + j);
+				}
+				for (unsigned int k = 0; k < columns; k++) {
+					const __m512 bValues = _mm512_maskz_loadu_ps(mask, b + k * bStride + j);
+					for (unsigned int r = 0; r < rows; r++) {
+						sums[r][k] = _mm512_fmadd_ps(aValues[r], bValues, sums[r][k]);
+					}
+				}
+			}
+			for (unsigned int k = 0; k < columns; k++) {
+				for (unsigned int r = 0; r < rows; r++) {
+					result[k * resultStride + r] = (c != nullptr ? c[r] : 0.0f) + _mm512_reduce_add_ps(sums[r][k]);
+				}
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void multiplyAndAddTile(const float* a, unsigned int aStride, const float* b, unsigned int bStride, const float* c,
+			float* result, unsigned int resultStride, unsigned int depth, unsigned int rows, unsigned int columns) {
+			if (rows == 4 && columns == 4) {
+				tile<4, 4>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else if (rows == 4 && columns == 1) {
+				tile<4, 1>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else if (rows == 1 && columns == 4) {
+				tile<1, 4>(a, aStride, b, bStride, c, result, resultStride, depth);
+			}
+			else {
+				for (unsigned int k = 0; k < columns; k++) {
+					for (unsigned int r = 0; r < rows; r++) {
+						result[k * resultStride + r] = (c != nullptr ? c[r] : 0.0f) + dot(a + r * aStride, b + k * bStride, depth);
+					}
+				}
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void add(float* destination, const float* source, unsigned int size) {
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				_mm512_mask_storeu_ps(destination + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, destination + i), _mm512_maskz_loadu_ps(mask, source + i)));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void subtract(float* destination, const float* source, unsigned int size) {
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				_mm512_mask_storeu_ps(destination + i, mask, _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, destination + i), _mm512_maskz_loadu_ps(mask, source + i)));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void scale(float* destination, float scalar, unsigned int size) {
+			const __m512 factor = _mm512_set1_ps(scalar);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				_mm512_mask_storeu_ps(destination + i, mask, _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, destination + i), factor));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void sigmoid(float* destination, const float* source, unsigned int size) {
+			const __m512 one = _mm512_set1_ps(1.0f);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				const __m512 e = exp(_mm512_sub_ps(_mm512_setzero_ps(), _mm512_maskz_loadu_ps(mask, source + i)));
+				_mm512_mask_storeu_ps(destination + i, mask, _mm512_div_ps(one, _mm512_add_ps(one, e)));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void exp(float* destination, const float* source, float offset, unsigned int size) {
+			const __m512 shift = _mm512_set1_ps(offset);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				_mm512_mask_storeu_ps(destination + i, mask, exp(_mm512_add_ps(_mm512_maskz_loadu_ps(mask, source + i), shift)));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void addScaledToColumns(float* destination, unsigned int destinationStride, const float* source, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				const __m512 values = _mm512_maskz_loadu_ps(mask, source + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					float* column = destination + k * destinationStride + i;
+					_mm512_mask_storeu_ps(column, mask, _mm512_fmadd_ps(_mm512_set1_ps(scalars[k * scalarStride]), values, _mm512_maskz_loadu_ps(mask, column)));
+				}
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void addScaledColumns(float* destination, const float* source, unsigned int sourceStride, const float* scalars, unsigned int scalarStride,
+			unsigned int columns, unsigned int size) {
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				__m512 sum = _mm512_maskz_loadu_ps(mask, destination + i);
+				for (unsigned int k = 0; k < columns; k++) {
+					sum = _mm512_fmadd_ps(_mm512_set1_ps(scalars[k * scalarStride]), _mm512_maskz_loadu_ps(mask, source + k * sourceStride + i), sum);
+				}
+				_mm512_mask_storeu_ps(destination + i, mask, sum);
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void momentumStep(float* parameters, float* velocity, const float* gradients, float learningRate, float momentum, unsigned int size) {
+			const __m512 rate = _mm512_set1_ps(learningRate);
+			const __m512 factor = _mm512_set1_ps(momentum);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				const __m512 v = _mm512_fmadd_ps(factor, _mm512_maskz_loadu_ps(mask, velocity + i), _mm512_mul_ps(rate, _mm512_maskz_loadu_ps(mask, gradients + i)));
+				_mm512_mask_storeu_ps(velocity + i, mask, v);
+				_mm512_mask_storeu_ps(parameters + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, parameters + i), v));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void rmsPropStep(float* parameters, float* meanSquares, const float* gradients, float learningRate, float decay, float epsilon, unsigned int size) {
+			const __m512 rate = _mm512_set1_ps(learningRate);
+			const __m512 factor = _mm512_set1_ps(decay);
+			const __m512 complement = _mm512_set1_ps(1.0f - decay);
+			const __m512 eps = _mm512_set1_ps(epsilon);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				const __m512 g = _mm512_maskz_loadu_ps(mask, gradients + i);
+				const __m512 s = _mm512_fmadd_ps(factor, _mm512_maskz_loadu_ps(mask, meanSquares + i), _mm512_mul_ps(complement, _mm512_mul_ps(g, g)));
+				_mm512_mask_storeu_ps(meanSquares + i, mask, s);
+				const __m512 step = _mm512_div_ps(_mm512_mul_ps(rate, g), _mm512_add_ps(_mm512_sqrt_ps(s), eps));
+				_mm512_mask_storeu_ps(parameters + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, parameters + i), step));
+			}
+		}
+
+		KERNELS_TARGET_AVX512 inline void adamStep(float* parameters, float* means, float* variances, const float* gradients, float learningRate, float beta1, float beta2, float epsilon, unsigned int size) {
+			const __m512 rate = _mm512_set1_ps(learningRate);
+			const __m512 b1 = _mm512_set1_ps(beta1);
+			const __m512 b1Complement = _mm512_set1_ps(1.0f - beta1);
+			const __m512 b2 = _mm512_set1_ps(beta2);
+			const __m512 b2Complement = _mm512_set1_ps(1.0f - beta2);
+			const __m512 eps = _mm512_set1_ps(epsilon);
+			for (unsigned int i = 0; i < size; i += 16) {
+				const __mmask16 mask = (size - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (size - i)) - 1);
+				const __m512 g = _mm512_maskz_loadu_ps(mask, gradients + i);
+				const __m512 m = _mm512_fmadd_ps(b1, _mm512_maskz_loadu_ps(mask, means + i), _mm512_mul_ps(b1Complement, g));
+				const __m512 v = _mm512_fmadd_ps(b2, _mm512_maskz_loadu_ps(mask, variances + i), _mm512_mul_ps(b2Complement, _mm512_mul_ps(g, g)));
+				_mm512_mask_storeu_ps(means + i, mask, m);
+				_mm512_mask_storeu_ps(variances + i, mask, v);
+				const __m512 step = _mm512_div_ps(_mm512_mul_ps(rate, m), _mm512_add_ps(_mm512_sqrt_ps(v), eps));
+				_mm512_mask_storeu_ps(parameters + i, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, parameters + i), step));
+			}
+		}
+	}
+#endif // KERNELS_X86
+
+	inline Level detectLevel() {
+#ifdef KERNELS_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		__cpuid(info, 1);
+		const bool sse2 = (info[3] & (1 << 26)) != 0;
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx2 = false;
+		bool avx512 = false;
+		if (osxsave && maxLeaf >= 7) {
+			const unsigned long long xcr0 = _xgetbv(0);
+			__cpuidex(info, 7, 0);
+			avx2 = fma && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+			avx512 = avx2 && (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+		}
+#else
+		__builtin_cpu_init();
+		const bool sse2 = __builtin_cpu_supports("sse2");
+		const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+		const bool avx512 = avx2 && __builtin_cpu_supports("avx512f");
+#endif
+		if (avx512) {
+			return Level::AVX512;
+		}
+		if (avx2) {
+			return Level::AVX2;
+		}
+		if (sse2) {
+			return Level::SSE;
+		}
+#endif
+		return Level::Scalar;
+	}
+
+	// returns kernels of the given level, falls back to scalar ones if the level is not compiled in
+	inline KernelTable getKernels(Level level) {
+#ifdef KERNELS_X86
+		switch (level) {
+		case Level::AVX512:
+			return { Level::AVX512, avx512::dot, avx512::multiplyAndAddTile, avx512::add, avx512::subtract, avx512::scale, avx512::sigmoid, avx512::exp,
+			avx512::addScaledToColumns, avx512::addScaledColumns, avx512::momentumStep, avx512::rmsPropStep, avx512::adamStep };
+		case Level::AVX2:
+			return { Level::AVX2, avx2::dot, avx2::multiplyAndAddTile, avx2::add, avx2::subtract, avx2::scale, avx2::sigmoid, avx2::exp,
+			avx2::addScaledToColumns, avx2::addScaledColumns, avx2::momentumStep, avx2::rmsPropStep, avx2::adamStep };
+		case Level::SSE:
+			return { Level::SSE, sse::dot, sse::multiplyAndAddTile, sse::add, sse::subtract, sse::scale, sse::sigmoid, sse::exp,
+			sse::addScaledToColumns, sse::addScaledColumns,
+			// optimizer steps are memory bound, SSE uses the scalar ones
+			scalar::momentumStep, scalar::rmsPropStep, scalar::adamStep };
+		default:
+			break;
+		}
+#endif
+		return { Level::Scalar, scalar::dot, scalar::multiplyAndAddTile, scalar::add, scalar::subtract, scalar::scale, scalar::sigmoid, scalar::exp,
+			scalar::addScaledToColumns, scalar::addScaledColumns, scalar::momentumStep, scalar::rmsPropStep, scalar::adamStep };
+	}
+
+	// kernels of the best level supported by this CPU
+	inline const KernelTable& get() {
+		static const KernelTable table = getKernels(detectLevel());
+		return table;
+	}
+
+	inline const char* getLevelName(Level level) {
+		switch (level) {
+		case Level::AVX512:
+			return "AVX-512";
+		case Level::AVX2:
+			return "AVX2";
+		case Level::SSE:
+			return "SSE";
+		default:
+			return "Scalar";
+		}
+	}
+}
+
+// checks every kernel level supported by this CPU against the scalar reference
+void testKernels() {
+	const unsigned int size = 203;
+	float a[size * 4];
+	float b[size * 4];
+	float c[4] = { 0.5f, -1.0f, 0.25f, 2.0f };
+	for (unsigned int i = 0; i < size * 4; i++) {
+		a[i] = (float)((int)(i * 37 % 101) - 50) / 25.0f;
+		b[i] = (float)((int)(i * 53 % 97) - 48) / 24.0f;
+	}
+
+	const kernels::Level best = kernels::detectLevel();
+	const kernels::KernelTable reference = kernels::getKernels(kernels::Level::Scalar);
+	for (int iLevel = (int)kernels::Level::Scalar; iLevel <= (int)best; iLevel++) {
+		const kernels::KernelTable tested = kernels::getKernels((kernels::Level)iLevel);
+		const float tolerance = 1e-4f;
+
+		for (unsigned int n : { 0u, 1u, 7u, 16u, 31u, size }) {
+			const float expected = reference.dot(a, b, n);
+			if (std::fabs(tested.dot(a, b, n) - expected) > tolerance * (1.0f + std::fabs(expected))) {
+				throw std::runtime_error("Kernel dot test failed");
+			}
+		}
+
+		for (unsigned int rows : { 1u, 2u, 4u }) {
+			for (unsigned int columns : { 1u, 3u, 4u }) {
+				float expected[16];
+				float result[16];
+				reference.multiplyAndAddTile(a, size, b, size, c, expected, 4, size, rows, columns);
+				tested.multiplyAndAddTile(a, size, b, size, c, result, 4, size, rows, columns);
+				for (unsigned int k = 0; k < columns; k++) {
+					for (unsigned int r = 0; r < rows; r++) {
+						if (std::fabs(result[k * 4 + r] - expected[k * 4 + r]) > tolerance * (1.0f + std::fabs(expected[k * 4 + r]))) {
+							throw std::runtime_error("Kernel multiplyAndAddTile test failed");
+						}
+					}
+				}
+			}
+		}
+
+		float expected[size * 4];
+		float result[size * 4];
+		for (unsigned int i = 0; i < size * 4; i++) {
+			expected[i] = result[i] = a[i];
+		}
+		reference.addScaledToColumns(expected, size, b, c, 1, 3, size);
+		tested.addScaledToColumns(result, size, b, c, 1, 3, size);
+		reference.addScaledColumns(expected + size * 3, b, size, c, 1, 4, size);
+		tested.addScaledColumns(result + size * 3, b, size, c, 1, 4, size);
+		for (unsigned int i = 0; i < size * 4; i++) {
+			if (std::fabs(result[i] - expected[i]) > tolerance * (1.0f + std::fabs(expected[i]))) {
+				throw std::runtime_error("Kernel addScaledToColumns/addScaledColumns test failed");
+			}
+		}
+		for (unsigned int i = 0; i < size; i++) {
+			expected[i] = result[i] = a[i];
+		}
+		reference.add(expected, b, size);
+		tested.add(result, b, size);
+		reference.subtract(expected, a + size, size);
+		tested.subtract(result, a + size, size);
+		reference.scale(expected, 0.75f, size);
+		tested.scale(result, 0.75f, size);
+		for (unsigned int i = 0; i < size; i++) {
+			if (std::fabs(result[i] - expected[i]) > tolerance * (1.0f + std::fabs(expected[i]))) {
+				throw std::runtime_error("Kernel add/subtract/scale test failed");
+			}
+		}
+
+		float inputs[size];
+		for (unsigned int i = 0; i < size; i++) {
+			inputs[i] = (float)((int)i - (int)size / 2) * 0.5f;
+		}
+		reference.sigmoid(expected, inputs, size);
+		tested.sigmoid(result, inputs, size);
+		for (unsigned int i = 0; i < size; i++) {
+			if (std::fabs(result[i] - expected[i]) > 1e-6f) {
+				throw std::runtime_error("Kernel sigmoid test failed");
+			}
+		}
+		float parameters[2][size];
+		float states[2][2][size];
+		for (unsigned int iCase = 0; iCase < 2; iCase++) {
+			for (unsigned int i = 0; i < size; i++) {
+				parameters[iCase][i] = a[i];
+				states[iCase][0][i] = std::fabs(b[i]);
+				states[iCase][1][i] = std::fabs(a[i + size]);
+			}
+		}
+		const kernels::KernelTable* tables[2] = { &reference, &tested };
+		for (unsigned int iCase = 0; iCase < 2; iCase++) {
+			tables[iCase]->momentumStep(parameters[iCase], states[iCase][0], b + size, 0.1f, 0.9f, size);
+			tables[iCase]->rmsPropStep(parameters[iCase], states[iCase][1], b + size * 2, 0.01f, 0.9f, 1e-8f, size);
+			tables[iCase]->adamStep(parameters[iCase], states[iCase][0], states[iCase][1], b + size * 3, 0.001f, 0.9f, 0.999f, 1e-8f, size);
+		}
+		for (unsigned int i = 0; i < size; i++) {
+			if (std::fabs(parameters[1][i] - parameters[0][i]) > tolerance * (1.0f + std::fabs(parameters[0][i])) ||
+				std::fabs(states[1][0][i] - states[0][0][i]) > tolerance * (1.0f + std::fabs(states[0][0][i])) ||
+				std::fabs(states[1][1][i] - states[0][1][i]) > tolerance * (1.0f + std::fabs(states[0][1][i]))) {
+				throw std::runtime_error("Kernel optimizer step test failed");
+			}
+		}
+
+		reference.exp(expected, inputs, -20.0f, size);
+		tested.exp(result, inputs, -20.0f, size);
+		for (unsigned int i = 0; i < size; i++) {
+			if (std::fabs(result[i] - expected[i]) > 1e-6f * expected[i]) {
+				throw std::runtime_error("Kernel exp test failed");
+			}
+		}
+
+		std::cout << "Kernels " << kernels::getLevelName(tested.level) << " test passed" << std::endl;
+	}
+}
@@ -1,29 +1,85 @@
 #pragma once
 
 #include "Matrix.hpp"
+#include "Activation.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
 
+// when defined, weights and their error sums are allocated with transparent huge pages
+// #define USE_HUGE_PAGES
+
+#ifdef USE_HUGE_PAGES
+using WeightAllocator = HugePageAllocator<float>;
+#else
+using WeightAllocator = AlignedAllocator<float>;
+#endif
+
+// when defined, layers keep a transposed copy of their weights in sync, so errors are back-propagated
+// with the same dot product kernel as the forward pass instead of scaling rows of the weights
+// #define KEEP_TRANSPOSED_WEIGHTS
+
+// uniform in [-1, 1), drawn from the generator of the calling thread, see seedThreadRandom
 float randomNormalizedFloat() {
-	float random = ((float)(rand() % RAND_MAX)) / (float)RAND_MAX;
-	float nr = random * 2.0f - 1.0f;
-	return nr;
+	return getThreadRandom().nextFloat(-1.0f, 1.0f);
 }
 
-class Layer {
-public:
-	Layer(unsigned int neuronCount, unsigned int outputSize, unsigned int batches)
-		: neuronCount(neuronCount), outputSize(outputSize), weights({ neuronCount, outputSize }), biases({ neuronCount }), weightErrorsSums({ neuronCount, outputSize, batches }),
-		errorsSums({ neuronCount, batches }), outputs({ neuronCount, batches }), inputs({ neuronCount, batches }), errors({ neuronCount, batches }) {
+// layers with at least this many weights have their neurons split across the workers when they are propagated
+// outside of the pool, below it waking the workers costs more than computing the layer on one thread
+constexpr unsigned int defaultParallelLayerThreshold = 128 * 1024;
+
+// inputs = weights * previousOutputs + biases and outputs = activation(inputs) for every column, with the neurons of the layer
+// split into one range per worker of threadPool, inputs and outputs may be the same view
+// has to be called from outside of threadPool, as its workers do not run other tasks while they wait
+void propagateParallel(ThreadPool& threadPool, const MatrixView2D<float>& weights, const MatrixView2D<float>& previousOutputs,
+	const MatrixView1D<float>& biases, Activation activation, const MatrixView2D<float>& inputs, const MatrixView2D<float>& outputs) {
+	const unsigned int neuronCount = biases.getSize();
+	// ranges are whole cache lines of the first column, columns are neuronCount floats apart, so in the other columns the
+	// boundaries are only on line boundaries when neuronCount is a multiple of a line, otherwise the two workers next to
+	// a boundary write one shared line per column, which is small next to the neurons of a range
+	const unsigned int perLine = cacheLineSize / sizeof(float);
+	const unsigned int lines = (neuronCount + perLine - 1) / perLine;
+	const unsigned int ranges = std::min(std::max(threadPool.getThreadCount(), 1u), lines);
+	// softmax normalizes over all neurons of a sample, so it waits for every range
+	const bool splitActivation = activation != Activation::Softmax;
+
+	threadPool.parallelFor(0, ranges, 1, [&](int range, int) {
+		const unsigned int first = lines * range / ranges * perLine;
+		const unsigned int count = std::min(lines * (range + 1) / ranges * perLine, neuronCount) - first;
+		const MatrixView2D<float> rangeInputs = inputs.range(first, count);
+		multiplyAndAdd(weights.slice(first, count), previousOutputs, biases.slice(first, count), rangeInputs);
+		if (splitActivation) {
+			applyActivation(activation, rangeInputs, outputs.range(first, count));
+		}
+	});
 
+	if (!splitActivation) {
+		applyActivation(activation, inputs, outputs);
+	}
+}
 
-		for (int i = 0; i < neuronCount; i++) {
+class Layer {
+public:
+	// batches - number of gradient accumulation slots, samples - number of samples that can be propagated at once
+	// every slot starts on its own cache line, so threads accumulating into different slots never write the same line
+	Layer(unsigned int neuronCount, unsigned int outputSize, unsigned int batches, unsigned int samples, Activation activation = Activation::Sigmoid)
+		: neuronCount(neuronCount), outputSize(outputSize), activation(activation), weights({ neuronCount, outputSize }), biases({ neuronCount }),
+		weightErrorsSums({ padToCacheLine<float>(neuronCount * outputSize), batches }), errorsSums({ padToCacheLine<float>(neuronCount), batches }),
+		outputs({ neuronCount, samples }), inputs({ neuronCount, samples }), errors({ neuronCount, samples })
+#ifdef KEEP_TRANSPOSED_WEIGHTS
+		, transposedWeights({ outputSize, neuronCount })
+#endif
+	{
+
+
+		for (unsigned int i = 0; i < neuronCount; i++) {
 			biases(i) = randomNormalizedFloat();
-			for (int j = 0; j < outputSize; j++) {
+			for (unsigned int j = 0; j < outputSize; j++) {
 				weights(i, j) = randomNormalizedFloat();
-				for (int k = 0; k < batches; k++) {
-					weightErrorsSums(i, j, k) = 0.0f;
-				}
 			}
 		}
+		weightErrorsSums.setAll(0.0f);
+		errorsSums.setAll(0.0f);
+		updateTransposedWeights();
 	}
 
 	unsigned int getNeuronCount() {
@@ -34,7 +90,11 @@ public:
 		return outputSize;
 	}
 
-	Matrix2D<float>& getWeights() {
+	Activation getActivation() {
+		return activation;
+	}
+
+	Matrix2D<float, WeightAllocator>& getWeights() {
 		return weights;
 	}
 
@@ -42,14 +102,28 @@ public:
 		return biases;
 	}
 
-	Matrix3D<float>& getWeightErrorsSums() {
+	// error sums of all slots, every column is one slot padded to whole cache lines
+	Matrix2D<float, WeightAllocator>& getWeightErrorsSums() {
 		return weightErrorsSums;
 	}
 
+	// error sums of the weights accumulated in a slot, shaped like the weights
+	MatrixView2D<float> getWeightErrorsSums(unsigned int slot) {
+		const unsigned int dimensions[2] = { neuronCount, outputSize };
+		const unsigned int strides[2] = { 1, neuronCount };
+		return MatrixView2D<float>(weightErrorsSums.dataAt(0, slot), dimensions, strides);
+	}
+
+	// error sums of all slots, every column is one slot padded to whole cache lines
 	Matrix2D<float>& getErrorsSums() {
 		return errorsSums;
 	}
 
+	// error sums of the biases accumulated in a slot
+	MatrixView1D<float> getErrorsSums(unsigned int slot) {
+		return errorsSums(slot).slice(0, neuronCount);
+	}
+
 	Matrix2D<float>& getOutputs() {
 		return outputs;
 	}
@@ -62,18 +136,50 @@ public:
 		return errors;
 	}
 
+	// number of samples that can be propagated at once
+	unsigned int getSampleCapacity() {
+		return outputs.getDimension(1);
+	}
+
+	// grows the outputs, inputs and errors to hold at least samples columns, their values are lost when they grow
+	void reserveSamples(unsigned int samples) {
+		if (samples > getSampleCapacity()) {
+			outputs = Matrix2D<float>({ neuronCount, samples });
+			inputs = Matrix2D<float>({ neuronCount, samples });
+			errors = Matrix2D<float>({ neuronCount, samples });
+		}
+	}
+
+#ifdef KEEP_TRANSPOSED_WEIGHTS
+	Matrix2D<float, WeightAllocator>& getTransposedWeights() {
+		return transposedWeights;
+	}
+#endif
+
+	// has to be called after the weights are modified
+	void updateTransposedWeights() {
+#ifdef KEEP_TRANSPOSED_WEIGHTS
+		transpose(weights, transposedWeights);
+#endif
+	}
+
 private:
 	unsigned int neuronCount;
 	unsigned int outputSize;
+	Activation activation;
 
-	Matrix2D<float> weights;
+	Matrix2D<float, WeightAllocator> weights;
 	Matrix1D<float> biases;
 
-	Matrix3D<float> weightErrorsSums;
+	Matrix2D<float, WeightAllocator> weightErrorsSums;
 	Matrix2D<float> errorsSums;
 
 	Matrix2D<float> outputs;
 	Matrix2D<float> inputs;
 
 	Matrix2D<float> errors;
+
+#ifdef KEEP_TRANSPOSED_WEIGHTS
+	Matrix2D<float, WeightAllocator> transposedWeights;
+#endif
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Activation.hpp"
+
+enum class Loss {
+	MeanSquaredError,
+	// categorical cross-entropy for softmax outputs, binary cross-entropy for sigmoid outputs
+	CrossEntropy
+};
+
+// smallest output passed to log, keeps the loss finite for saturated outputs
+constexpr float crossEntropyEpsilon = 1e-7f;
+
+void checkLoss(Loss loss, Activation outputActivation) {
+	if (loss == Loss::CrossEntropy && outputActivation != Activation::Softmax && outputActivation != Activation::Sigmoid) {
+		throw std::invalid_argument("Cross-entropy loss requires softmax or sigmoid output layer");
+	}
+}
+
+// loss of a single sample, mean squared error is averaged over the outputs, cross-entropy is summed
+float computeLoss(Loss loss, Activation outputActivation, const float* outputs, const float* targets, unsigned int size) {
+	float error = 0.0f;
+	if (loss == Loss::MeanSquaredError) {
+		for (unsigned int i = 0; i < size; i++) {
+			const float delta = targets[i] - outputs[i];
+			error += delta * delta;
+		}
+		return error / size;
+	}
+
+	for (unsigned int i = 0; i < size; i++) {
+		const float output = std::clamp(outputs[i], crossEntropyEpsilon, 1.0f - crossEntropyEpsilon);
+		error -= targets[i] * std::log(output);
+		if (outputActivation == Activation::Sigmoid) {
+			error -= (1.0f - targets[i]) * std::log(1.0f - output);
+		}
+	}
+	return error;
+}
+
+// errors of the output layer for one sample, target - output
+// for cross-entropy this already is the error at the inputs of the output layer, as the activation derivative cancels
+// against the loss derivative, so it never saturates and the exp of the activation is not evaluated again
+void computeOutputErrors(const float* outputs, const float* targets, float* errors, unsigned int size) {
+	for (unsigned int i = 0; i < size; i++) {
+		errors[i] = targets[i] - outputs[i];
+	}
+}
@@ -1,55 +1,32 @@
 #pragma once
 #include <initializer_list>
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
+
+#include "Allocator.hpp"
+#include "Kernels.hpp"
 
 // #define CHECK_INDEX
 
+// non-owning view of matrix data, dimension 0 is the innermost one
+// indexing with fewer indices than dimensions selects along the last dimensions and returns a view by value
 template <typename T, unsigned int nDim>
-class Matrix {
+class MatrixView {
 public:
-	Matrix(const std::array<unsigned int, nDim>& dimensions) : isSubMatrix(false) {
-		this->size = 1;
+	MatrixView() : data(nullptr), size(0), dimensions{}, strides{} {}
+
+	MatrixView(T* data, const unsigned int* dimensions, const unsigned int* strides) : data(data), size(1) {
 		for (unsigned int i = 0; i < nDim; ++i) {
 			this->dimensions[i] = dimensions[i];
+			this->strides[i] = strides[i];
 			this->size *= dimensions[i];
 		}
-		if (size > 0) {
-			this->data = new T[size];
-		}
-		else {
-			this->data = nullptr;
-		}
-		this->size = size;
-	}
-
-	Matrix(const Matrix<T, nDim + 1>& master, unsigned int index) : isSubMatrix(true) {
-		this->size = 1;
-		for (unsigned int i = 0; i < nDim; ++i) {
-			this->dimensions[i] = master.getDimension(i);
-			this->size *= master.getDimension(i);
-		}
-
-		if (this->size > 0) {
-			this->data = master.getData() + index;
-		}
-		else {
-			this->data = nullptr;
-		}
-	}
-
-	Matrix(const Matrix& other) {
-		*this = other;
-	}
-
-	Matrix& operator=(const Matrix& other) {
-		for (unsigned int i = 0; i < size; ++i) {
-			data[i] = other.data[i];
-		}
-		return *this;
 	}
 
 	template <typename... Args>
@@ -60,10 +37,38 @@ public:
 			return (T&)(data[index]);
 		}
 		else {
-			return std::make_unique<Matrix<T, nDim - argSize>>(*this, index);
+			return MatrixView<T, nDim - argSize>(data + index, dimensions, strides);
+		}
+	}
+
+	// view of indices [first, first + count) of the last dimension
+	MatrixView slice(unsigned int first, unsigned int count) const {
+#ifdef CHECK_INDEX
+		if (first + count > dimensions[nDim - 1]) {
+			throw std::out_of_range("Index out of range");
+		}
+#endif
+		MatrixView view(data + first * strides[nDim - 1], dimensions, strides);
+		view.dimensions[nDim - 1] = count;
+		view.size = (dimensions[nDim - 1] > 0) ? size / dimensions[nDim - 1] * count : 0;
+		return view;
+	}
+
+	// view of indices [first, first + count) of the first dimension, for a layer these are a range of its neurons
+	// unlike slice, the view is not contiguous when it has more than one column, see forEachRun
+	MatrixView range(unsigned int first, unsigned int count) const {
+#ifdef CHECK_INDEX
+		if (first + count > dimensions[0]) {
+			throw std::out_of_range("Index out of range");
 		}
+#endif
+		MatrixView view(data + first * strides[0], dimensions, strides);
+		view.dimensions[0] = count;
+		view.size = (dimensions[0] > 0) ? size / dimensions[0] * count : 0;
+		return view;
 	}
 
+	// begin, end, getData and getSize only cover the whole view when it is contiguous
 	const T* begin() const {
 		return data;
 	}
@@ -76,125 +81,299 @@ public:
 		return data;
 	}
 
+	unsigned int getSize() const {
+		return size;
+	}
+
 	unsigned int getDimension(unsigned int dim) const {
 		return dimensions[dim];
 	}
 
-	void setAll(T value) {
-		for (unsigned int i = 0; i < size; ++i) {
-			data[i] = value;
+	unsigned int getStride(unsigned int dim) const {
+		return strides[dim];
+	}
+
+	// true when the view covers a single dense block of memory, which is not the case for a range of several columns
+	bool isContiguous() const {
+		if (size == 0) {
+			return true;
+		}
+		unsigned int denseStride = 1;
+		for (unsigned int i = 0; i < nDim; i++) {
+			if (dimensions[i] > 1 && strides[i] != denseStride) {
+				return false;
+			}
+			denseStride *= dimensions[i];
+		}
+		return true;
+	}
+
+	// calls function(data, length) for the contiguous parts of the view, the whole view when it is contiguous
+	// and every column of the first dimension otherwise
+	template <typename Function>
+	void forEachRun(Function function) const {
+		if (isContiguous()) {
+			function(data, size);
+			return;
+		}
+		for (unsigned int run = 0; run < size / dimensions[0]; run++) {
+			function(getRun(run), dimensions[0]);
 		}
 	}
 
+	// calls function(data, otherData, length) for the matching contiguous parts of this view and other
+	template <typename Function>
+	void forEachRun(const MatrixView& other, Function function) const {
+		if (isContiguous() && other.isContiguous()) {
+			function(data, other.data, size);
+			return;
+		}
+		for (unsigned int i = 0; i < nDim; i++) {
+			if (dimensions[i] != other.dimensions[i]) {
+				throw std::invalid_argument("Matrix dimensions do not match");
+			}
+		}
+		for (unsigned int run = 0; run < size / dimensions[0]; run++) {
+			function(getRun(run), other.getRun(run), dimensions[0]);
+		}
+	}
+
+	void setAll(T value) const {
+		forEachRun([value](T* run, unsigned int length) {
+			std::fill(run, run + length, value);
+		});
+	}
+
 	template <typename... Args>
 	T* dataAt(Args... args) const {
 		return data + getIndex(args...);
 	}
 
-	void applyFunction(std::function<T(T)> function) {
-		for (unsigned int i = 0; i < this->size; i++) {
-			this->data[i] = function(this->data[i]);
+	void copyFrom(const MatrixView& other) const {
+		if (this->size != other.size) {
+			throw std::invalid_argument("Matrix sizes do not match");
 		}
+		forEachRun(other, [](T* run, T* otherRun, unsigned int length) {
+			std::copy(otherRun, otherRun + length, run);
+		});
 	}
 
-	void applyFunction(const Matrix& source, std::function<T(T)> function) {
-		for (unsigned int i = 0; i < this->size; i++) {
-			this->data[i] = function(source.data[i]);
-		}
+	// function is taken by value, so lambdas and function objects are inlined into the loop
+	template <typename Function>
+	void applyFunction(Function function) const {
+		forEachRun([function](T* run, unsigned int length) {
+			for (unsigned int i = 0; i < length; i++) {
+				run[i] = function(run[i]);
+			}
+		});
 	}
 
-	const Matrix& add(const Matrix& other) {
+	template <typename Function>
+	void applyFunction(const MatrixView& source, Function function) const {
+		forEachRun(source, [function](T* run, T* sourceRun, unsigned int length) {
+			for (unsigned int i = 0; i < length; i++) {
+				run[i] = function(sourceRun[i]);
+			}
+		});
+	}
+
+	const MatrixView& add(const MatrixView& other) const {
 		if (this->size != other.size) {
 			throw std::invalid_argument("Matrix sizes do not match");
 		}
-		for (unsigned int i = 0; i < this->size; i++) {
-			data[i] += other.data[i];
-		}
+		forEachRun(other, [](T* run, T* otherRun, unsigned int length) {
+			if constexpr (std::is_same_v<T, float>) {
+				kernels::get().add(run, otherRun, length);
+			}
+			else {
+				for (unsigned int i = 0; i < length; i++) {
+					run[i] += otherRun[i];
+				}
+			}
+		});
 		return *this;
 	}
 
-	const Matrix& subtract(const Matrix& other) {
+	const MatrixView& subtract(const MatrixView& other) const {
 		if (this->size != other.size) {
 			throw std::invalid_argument("Matrix sizes do not match");
 		}
-		for (unsigned int i = 0; i < this->size; i++) {
-			data[i] -= other.data[i];
-		}
+		forEachRun(other, [](T* run, T* otherRun, unsigned int length) {
+			if constexpr (std::is_same_v<T, float>) {
+				kernels::get().subtract(run, otherRun, length);
+			}
+			else {
+				for (unsigned int i = 0; i < length; i++) {
+					run[i] -= otherRun[i];
+				}
+			}
+		});
 		return *this;
 	}
-	
-	const Matrix& operator+=(const Matrix& other) {
+
+	const MatrixView& operator+=(const MatrixView& other) const {
 		return add(other);
 	}
 
-	const Matrix& operator-=(const Matrix& other) {
+	const MatrixView& operator-=(const MatrixView& other) const {
 		return subtract(other);
 	}
 
-	const Matrix& operator*=(T scalar) {
-		for (unsigned int i = 0; i < this->size; i++) {
-			data[i] *= scalar;
-		}
+	const MatrixView& operator*=(T scalar) const {
+		forEachRun([scalar](T* run, unsigned int length) {
+			if constexpr (std::is_same_v<T, float>) {
+				kernels::get().scale(run, scalar, length);
+			}
+			else {
+				for (unsigned int i = 0; i < length; i++) {
+					run[i] *= scalar;
+				}
+			}
+		});
 		return *this;
 	}
 
-	~Matrix() {
-		if (!isSubMatrix) {
-			delete[] data;
-		}
-	}
-
-private:
+protected:
+	// views select along the last dimensions of a dense matrix with slice and indexing, which keeps them contiguous,
+	// or along the first dimension with range, which leaves gaps between the columns, size based operations go through
+	// forEachRun, so they are correct for both
 	T* data;
 	unsigned int size;
 	unsigned int dimensions[nDim];
-	bool isSubMatrix;
+	unsigned int strides[nDim];
 
 	template <typename... Args>
 	inline const auto getIndex(Args... args) const {
-		const unsigned int argsArr[] = { args... };
+		const unsigned int argsArr[] = { (unsigned int)args... };
 		constexpr unsigned int argSize = sizeof...(Args);
 		constexpr unsigned int argNDim = (argSize > nDim) ? nDim : argSize;
+		constexpr unsigned int argDiff = nDim - argNDim;
 
 #ifdef CHECK_INDEX
 		for (unsigned int i = 0; i < argNDim; i++) {
-			if (argsArr[i] >= dimensions[i]) {
+			if (argsArr[i] >= dimensions[i + argDiff]) {
 				throw std::out_of_range("Index out of range");
 			}
 		}
 #endif
-		
+
 		unsigned int index = 0;
-		unsigned int multi = 1;
+		for (unsigned int i = 0; i < argNDim; i++) {
+			index += argsArr[i] * strides[i + argDiff];
+		}
 
-		constexpr unsigned int argDiff = nDim - argNDim;
-		if constexpr (argSize < nDim) {
-			for (unsigned int i = 0; i < argDiff; i++) {
-				multi *= dimensions[i];
-			}
+		return index;
+	}
+
+	// start of column run of the first dimension, columns are numbered in the memory order of a dense matrix
+	T* getRun(unsigned int run) const {
+		unsigned int index = 0;
+		for (unsigned int i = 1; i < nDim; i++) {
+			index += (run % dimensions[i]) * strides[i];
+			run /= dimensions[i];
 		}
+		return data + index;
+	}
+};
 
-		for (unsigned int i = 0; i < argNDim; i++) {
-			index += argsArr[i] * multi;
-			multi *= dimensions[i + argDiff];
+// owning matrix, storage is obtained from Allocator (cache-line aligned by default)
+template <typename T, unsigned int nDim, typename Allocator = AlignedAllocator<T>>
+class Matrix : public MatrixView<T, nDim> {
+public:
+	Matrix(const std::array<unsigned int, nDim>& dimensions) {
+		this->size = 1;
+		for (unsigned int i = 0; i < nDim; ++i) {
+			this->dimensions[i] = dimensions[i];
+			this->strides[i] = this->size;
+			this->size *= dimensions[i];
 		}
+		allocate();
+	}
 
-		return index;
+	Matrix(const Matrix& other) : MatrixView<T, nDim>(nullptr, other.dimensions, other.strides) {
+		allocate();
+		std::copy(other.data, other.data + other.size, this->data);
+	}
+
+	Matrix(Matrix&& other) noexcept : MatrixView<T, nDim>(other.data, other.dimensions, other.strides) {
+		other.data = nullptr;
+		other.size = 0;
+	}
+
+	Matrix& operator=(const Matrix& other) {
+		if (this == &other) {
+			return *this;
+		}
+		if (this->size != other.size) {
+			release();
+			this->size = other.size;
+			allocate();
+		}
+		for (unsigned int i = 0; i < nDim; ++i) {
+			this->dimensions[i] = other.dimensions[i];
+			this->strides[i] = other.strides[i];
+		}
+		std::copy(other.data, other.data + other.size, this->data);
+		return *this;
+	}
+
+	Matrix& operator=(Matrix&& other) noexcept {
+		if (this != &other) {
+			release();
+			MatrixView<T, nDim>::operator=(other);
+			other.data = nullptr;
+			other.size = 0;
+		}
+		return *this;
+	}
+
+	~Matrix() {
+		release();
+	}
+
+private:
+	Allocator allocator;
+
+	void allocate() {
+		if (this->size > 0) {
+			this->data = allocator.allocate(this->size);
+			std::uninitialized_default_construct_n(this->data, this->size);
+		}
+		else {
+			this->data = nullptr;
+		}
+	}
+
+	void release() {
+		if (this->data != nullptr) {
+			std::destroy_n(this->data, this->size);
+			allocator.deallocate(this->data, this->size);
+			this->data = nullptr;
+		}
 	}
 };
 
 template <typename T>
-using Matrix1D = Matrix<T, 1>;
+using MatrixView1D = MatrixView<T, 1>;
 
 template <typename T>
-using Matrix2D = Matrix<T, 2>;
+using MatrixView2D = MatrixView<T, 2>;
 
 template <typename T>
-using Matrix3D = Matrix<T, 3>;
+using MatrixView3D = MatrixView<T, 3>;
+
+template <typename T, typename Allocator = AlignedAllocator<T>>
+using Matrix1D = Matrix<T, 1, Allocator>;
+
+template <typename T, typename Allocator = AlignedAllocator<T>>
+using Matrix2D = Matrix<T, 2, Allocator>;
+
+template <typename T, typename Allocator = AlignedAllocator<T>>
+using Matrix3D = Matrix<T, 3, Allocator>;
 
 // result = a * b + c
 template <typename T>
-void multiplyAndAdd(const Matrix2D<T>& a, const Matrix1D<T>& b, const Matrix1D<T>& c, Matrix1D<T>& result) {
+void multiplyAndAdd(const MatrixView2D<T>& a, const MatrixView1D<T>& b, const MatrixView1D<T>& c, const MatrixView1D<T>& result) {
 	unsigned int aCols = a.getDimension(0);
 	unsigned int aRows = a.getDimension(1);
 
@@ -206,13 +385,18 @@ void multiplyAndAdd(const Matrix2D<T>& a, const Matrix1D<T>& b, const Matrix1D<T
 
 	if (aCols == bRows && aRows == cRows && aRows == resultRows) {
 		for (unsigned int i = 0; i < aRows; i++) {
-			T sum = c(i);
 			T* aRowStart = a.dataAt(0, i);
 			T* bRowStart = b.dataAt(0);
-			for (unsigned int j = 0; j < aCols; j++) {
-				sum += aRowStart[j] * bRowStart[j];
+			if constexpr (std::is_same_v<T, float>) {
+				result(i) = c(i) + kernels::get().dot(aRowStart, bRowStart, aCols);
+			}
+			else {
+				T sum = c(i);
+				for (unsigned int j = 0; j < aCols; j++) {
+					sum += aRowStart[j] * bRowStart[j];
+				}
+				result(i) = sum;
 			}
-			result(i) = sum;
 		}
 	}
 	else {
@@ -220,6 +404,276 @@ void multiplyAndAdd(const Matrix2D<T>& a, const Matrix1D<T>& b, const Matrix1D<T
 	}
 }
 
+// computes a tile of result = a * b + c, where rows are rows of a and columns are columns of b, c may be nullptr
+template <typename T, unsigned int rows, unsigned int columns>
+inline void multiplyAndAddTile(const T* a, unsigned int aStride, const T* b, unsigned int bStride, const T* c, T* result, unsigned int resultStride, unsigned int depth) {
+	T sums[rows][columns];
+	for (unsigned int r = 0; r < rows; r++) {
+		for (unsigned int k = 0; k < columns; k++) {
+			sums[r][k] = (c != nullptr) ? c[r] : T(0);
+		}
+	}
+	for (unsigned int j = 0; j < depth; j++) {
+		T aValues[rows];
+		for (unsigned int r = 0; r < rows; r++) {
+			aValues[r] = a[r * aStride + j];
+		}
+		for (unsigned int k = 0; k < columns; k++) {
+			const T bValue = b[k * bStride + j];
+			for (unsigned int r = 0; r < rows; r++) {
+				sums[r][k] += aValues[r] * bValue;
+			}
+		}
+	}
+	for (unsigned int k = 0; k < columns; k++) {
+		for (unsigned int r = 0; r < rows; r++) {
+			result[k * resultStride + r] = sums[r][k];
+		}
+	}
+}
+
+// result(:, k) = a * b(:, k) + c, for every column k of b, c may be nullptr
+// a block of rows of a is kept in cache while all columns of b are multiplied by it,
+// so each weight is read from memory once per call instead of once per column
+template <typename T>
+void multiplyAndAddColumns(const MatrixView2D<T>& a, const MatrixView2D<T>& b, const T* cData, const MatrixView2D<T>& result) {
+	constexpr unsigned int rowBlock = 4;
+	constexpr unsigned int columnBlock = 4;
+
+	const unsigned int aCols = a.getDimension(0);
+	const unsigned int aRows = a.getDimension(1);
+	const unsigned int columnCount = b.getDimension(1);
+
+	const T* aData = a.getData();
+	const T* bData = b.getData();
+	T* resultData = result.getData();
+	const unsigned int aStride = a.getStride(1);
+	const unsigned int bStride = b.getStride(1);
+	const unsigned int resultStride = result.getStride(1);
+
+	if constexpr (std::is_same_v<T, float>) {
+		const kernels::KernelTable& kernelTable = kernels::get();
+		for (unsigned int i = 0; i < aRows; i += rowBlock) {
+			const unsigned int rows = std::min(rowBlock, aRows - i);
+			for (unsigned int k = 0; k < columnCount; k += columnBlock) {
+				const unsigned int columns = std::min(columnBlock, columnCount - k);
+				kernelTable.multiplyAndAddTile(aData + i * aStride, aStride, bData + k * bStride, bStride, (cData != nullptr) ? cData + i : nullptr,
+					resultData + k * resultStride + i, resultStride, aCols, rows, columns);
+			}
+		}
+		return;
+	}
+
+	unsigned int i = 0;
+	for (; i + rowBlock <= aRows; i += rowBlock) {
+		const T* c = (cData != nullptr) ? cData + i : nullptr;
+		unsigned int k = 0;
+		for (; k + columnBlock <= columnCount; k += columnBlock) {
+			multiplyAndAddTile<T, rowBlock, columnBlock>(aData + i * aStride, aStride, bData + k * bStride, bStride, c, resultData + k * resultStride + i, resultStride, aCols);
+		}
+		for (; k < columnCount; k++) {
+			multiplyAndAddTile<T, rowBlock, 1>(aData + i * aStride, aStride, bData + k * bStride, bStride, c, resultData + k * resultStride + i, resultStride, aCols);
+		}
+	}
+	for (; i < aRows; i++) {
+		const T* c = (cData != nullptr) ? cData + i : nullptr;
+		unsigned int k = 0;
+		for (; k + columnBlock <= columnCount; k += columnBlock) {
+			multiplyAndAddTile<T, 1, columnBlock>(aData + i * aStride, aStride, bData + k * bStride, bStride, c, resultData + k * resultStride + i, resultStride, aCols);
+		}
+		for (; k < columnCount; k++) {
+			multiplyAndAddTile<T, 1, 1>(aData + i * aStride, aStride, bData + k * bStride, bStride, c, resultData + k * resultStride + i, resultStride, aCols);
+		}
+	}
+}
+
+// result(:, k) = a * b(:, k) + c, for every column k of b
+template <typename T>
+void multiplyAndAdd(const MatrixView2D<T>& a, const MatrixView2D<T>& b, const MatrixView1D<T>& c, const MatrixView2D<T>& result) {
+	if (a.getDimension(0) != b.getDimension(0) || a.getDimension(1) != c.getDimension(0) || a.getDimension(1) != result.getDimension(0) || b.getDimension(1) != result.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+	multiplyAndAddColumns(a, b, c.getData(), result);
+}
+
+// result(:, k) = a * b(:, k), for every column k of b
+template <typename T>
+void multiply(const MatrixView2D<T>& a, const MatrixView2D<T>& b, const MatrixView2D<T>& result) {
+	if (a.getDimension(0) != b.getDimension(0) || a.getDimension(1) != result.getDimension(0) || b.getDimension(1) != result.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+	multiplyAndAddColumns(a, b, (const T*)nullptr, result);
+}
+
+// result(:, k) = transpose(a) * b(:, k), for every column k of b
+// each row of a is contiguous in memory and is scaled into a block of result columns,
+// so a is walked in storage order and read once per block instead of once per element
+template <typename T>
+void multiplyTransposed(const MatrixView2D<T>& a, const MatrixView2D<T>& b, const MatrixView2D<T>& result) {
+	constexpr unsigned int columnBlock = 4;
+
+	const unsigned int aCols = a.getDimension(0);
+	const unsigned int aRows = a.getDimension(1);
+	const unsigned int columnCount = b.getDimension(1);
+
+	if (aRows != b.getDimension(0) || aCols != result.getDimension(0) || columnCount != result.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+
+	const unsigned int aStride = a.getStride(1);
+	const unsigned int bStride = b.getStride(1);
+	const unsigned int resultStride = result.getStride(1);
+
+	result.setAll(T(0));
+	for (unsigned int k = 0; k < columnCount; k += columnBlock) {
+		const unsigned int columns = std::min(columnBlock, columnCount - k);
+		T* resultColumns = result.getData() + k * resultStride;
+		const T* bColumns = b.getData() + k * bStride;
+		for (unsigned int j = 0; j < aRows; j++) {
+			const T* aRow = a.getData() + j * aStride;
+			if constexpr (std::is_same_v<T, float>) {
+				kernels::get().addScaledToColumns(resultColumns, resultStride, aRow, bColumns + j, bStride, columns, aCols);
+			}
+			else {
+				for (unsigned int kk = 0; kk < columns; kk++) {
+					const T scalar = bColumns[kk * bStride + j];
+					for (unsigned int i = 0; i < aCols; i++) {
+						resultColumns[kk * resultStride + i] += scalar * aRow[i];
+					}
+				}
+			}
+		}
+	}
+}
+
+// result(i, j) += sum over columns k of a(i, k) * b(j, k)
+// every row of result is written once, with all columns of a accumulated into it
+template <typename T>
+void addOuterProducts(const MatrixView2D<T>& a, const MatrixView2D<T>& b, const MatrixView2D<T>& result) {
+	const unsigned int aRows = a.getDimension(0);
+	const unsigned int bRows = b.getDimension(0);
+	const unsigned int columnCount = a.getDimension(1);
+
+	if (columnCount != b.getDimension(1) || aRows != result.getDimension(0) || bRows != result.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+
+	const unsigned int aStride = a.getStride(1);
+	const unsigned int bStride = b.getStride(1);
+	const unsigned int resultStride = result.getStride(1);
+
+	for (unsigned int j = 0; j < bRows; j++) {
+		T* resultRow = result.getData() + j * resultStride;
+		const T* bRow = b.getData() + j;
+		if constexpr (std::is_same_v<T, float>) {
+			kernels::get().addScaledColumns(resultRow, a.getData(), aStride, bRow, bStride, columnCount, aRows);
+		}
+		else {
+			for (unsigned int k = 0; k < columnCount; k++) {
+				const T scalar = bRow[k * bStride];
+				const T* aColumn = a.getData() + k * aStride;
+				for (unsigned int i = 0; i < aRows; i++) {
+					resultRow[i] += scalar * aColumn[i];
+				}
+			}
+		}
+	}
+}
+
+// columns of bytes read as scale * byte + offset, e.g. raw pixels that are normalized while they are read
+struct ByteColumns {
+	const std::uint8_t* data;
+	// values per column
+	unsigned int rows;
+	// bytes from the start of one column to the next
+	unsigned int stride;
+	unsigned int count;
+	float scale;
+	float offset;
+
+	// columns [first, first + count)
+	ByteColumns slice(unsigned int first, unsigned int count) const {
+		return { data + first * stride, rows, stride, count, scale, offset };
+	}
+};
+
+// columns of bytes converted at once, the converted block stays in cache while it is used and is then overwritten
+// by the next one, so the bytes are never stored as floats in memory
+unsigned int getByteColumnBlock(unsigned int rows) {
+	constexpr unsigned int blockBytes = 64 * 1024;
+	// multiple of the column block of the matrix product kernel
+	return std::max(blockBytes / (std::max(rows, 1u) * (unsigned int)sizeof(float)) / 4 * 4, 4u);
+}
+
+// block of byte columns converted to floats in a buffer of the calling thread, valid until the next call on the thread
+MatrixView2D<float> convertByteColumns(const ByteColumns& columns) {
+	thread_local Matrix1D<float> buffer({ 0 });
+	if (buffer.getSize() < columns.rows * columns.count) {
+		buffer = Matrix1D<float>({ columns.rows * columns.count });
+	}
+	float* destination = buffer.getData();
+	for (unsigned int k = 0; k < columns.count; k++) {
+		const std::uint8_t* source = columns.data + k * columns.stride;
+		for (unsigned int i = 0; i < columns.rows; i++) {
+			destination[k * columns.rows + i] = columns.scale * source[i] + columns.offset;
+		}
+	}
+	const unsigned int dimensions[2] = { columns.rows, columns.count };
+	const unsigned int strides[2] = { 1, columns.rows };
+	return MatrixView2D<float>(destination, dimensions, strides);
+}
+
+// result(:, k) = a * (scale * b(:, k) + offset) + c, for every column k of b
+// the conversion is fused into the product a block of columns at a time
+void multiplyAndAdd(const MatrixView2D<float>& a, const ByteColumns& b, const MatrixView1D<float>& c, const MatrixView2D<float>& result) {
+	if (a.getDimension(0) != b.rows || a.getDimension(1) != c.getDimension(0) || a.getDimension(1) != result.getDimension(0) || b.count != result.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+	const unsigned int block = getByteColumnBlock(b.rows);
+	for (unsigned int k = 0; k < b.count; k += block) {
+		const unsigned int columns = std::min(block, b.count - k);
+		multiplyAndAddColumns(a, convertByteColumns(b.slice(k, columns)), c.getData(), result.slice(k, columns));
+	}
+}
+
+// result(i, j) += sum over columns k of (scale * a(i, k) + offset) * b(j, k)
+// the conversion is fused into the accumulation a block of columns at a time
+void addOuterProducts(const ByteColumns& a, const MatrixView2D<float>& b, const MatrixView2D<float>& result) {
+	if (a.count != b.getDimension(1)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+	const unsigned int block = getByteColumnBlock(a.rows);
+	for (unsigned int k = 0; k < a.count; k += block) {
+		const unsigned int columns = std::min(block, a.count - k);
+		addOuterProducts(convertByteColumns(a.slice(k, columns)), b.slice(k, columns), result);
+	}
+}
+
+// result(i, j) = a(j, i)
+template <typename T>
+void transpose(const MatrixView2D<T>& a, const MatrixView2D<T>& result) {
+	constexpr unsigned int block = 16;
+
+	const unsigned int aCols = a.getDimension(0);
+	const unsigned int aRows = a.getDimension(1);
+
+	if (aCols != result.getDimension(1) || aRows != result.getDimension(0)) {
+		throw std::invalid_argument("Invalid matrix dimensions");
+	}
+
+	for (unsigned int j0 = 0; j0 < aRows; j0 += block) {
+		for (unsigned int i0 = 0; i0 < aCols; i0 += block) {
+			const unsigned int jEnd = std::min(j0 + block, aRows);
+			const unsigned int iEnd = std::min(i0 + block, aCols);
+			for (unsigned int j = j0; j < jEnd; j++) {
+				for (unsigned int i = i0; i < iEnd; i++) {
+					result(j, i) = a(i, j);
+				}
+			}
+		}
+	}
+}
+
 void testMatrix() {
 	Matrix2D<float> a({ 3, 2 });
 	Matrix1D<float> b({ 3 });
@@ -266,14 +720,121 @@ void testMatrix() {
 	const int z = 1;
 	std::cout << m(0, 0, z) << " " << m(0, 1, z) << " " << m(1, 0, z) << " " << m(1, 1, z) << std::endl;
 
-	auto m2 = m(z);
-	std::cout << (*m2)(0, 0) << " " << (*m2)(0, 1) << " " << (*m2)(1, 0) << " " << (*m2)(1, 1) << std::endl;
+	MatrixView2D<float> m2 = m(z);
+	std::cout << m2(0, 0) << " " << m2(0, 1) << " " << m2(1, 0) << " " << m2(1, 1) << std::endl;
 
-	if ((*m2)(0, 0) != 2 || (*m2)(0, 1) != 4 || (*m2)(1, 0) != 6 || (*m2)(1, 1) != 8) {
+	if (m2(0, 0) != 2 || m2(0, 1) != 4 || m2(1, 0) != 6 || m2(1, 1) != 8) {
 		throw std::runtime_error("Matrix test failed");
 	}
 	else {
 		std::cout << "Matrix test_1 passed" << std::endl;
 	}
+
+	Matrix2D<float> w({ 3, 5 });
+	Matrix2D<float> x({ 3, 6 });
+	Matrix1D<float> bias({ 5 });
+	Matrix2D<float> y({ 5, 6 });
+	for (unsigned int i = 0; i < 5; i++) {
+		bias(i) = (float)i;
+		for (unsigned int j = 0; j < 3; j++) {
+			w(j, i) = (float)(i + j);
+		}
+	}
+	for (unsigned int k = 0; k < 6; k++) {
+		for (unsigned int j = 0; j < 3; j++) {
+			x(j, k) = (float)(k * 3 + j);
+		}
+	}
+	y.setAll(-1.0f);
+	multiplyAndAdd(w, x.slice(1, 5), bias, y.slice(1, 5));
+
+	for (unsigned int k = 0; k < 6; k++) {
+		for (unsigned int i = 0; i < 5; i++) {
+			float expected = -1.0f;
+			if (k >= 1) {
+				expected = bias(i);
+				for (unsigned int j = 0; j < 3; j++) {
+					expected += w(j, i) * x(j, k);
+				}
+			}
+			if (y(i, k) != expected) {
+				throw std::runtime_error("Matrix test failed");
+			}
+		}
+	}
+	std::cout << "Matrix test_2 passed" << std::endl;
+
+	Matrix2D<float> copied(y);
+	Matrix2D<float> moved(std::move(copied));
+	if (copied.getData() != nullptr || moved(4, 5) != y(4, 5) || ((std::uintptr_t)moved.getData() % 64) != 0) {
+		throw std::runtime_error("Matrix test failed");
+	}
+	std::cout << "Matrix test_3 passed" << std::endl;
+
+	Matrix2D<float> e({ 5, 6 });
+	Matrix2D<float> back({ 3, 6 });
+	Matrix2D<float> outer({ 3, 5 });
+	Matrix2D<float> wt({ 5, 3 });
+	for (unsigned int k = 0; k < 6; k++) {
+		for (unsigned int i = 0; i < 5; i++) {
+			e(i, k) = (float)(i + 2 * k) - 4.0f;
+		}
+	}
+	outer.setAll(1.0f);
+	multiplyTransposed(w, e, back);
+	addOuterProducts(x, e, outer);
+	transpose(w, wt);
+	for (unsigned int j = 0; j < 3; j++) {
+		for (unsigned int k = 0; k < 6; k++) {
+			float expected = 0.0f;
+			for (unsigned int i = 0; i < 5; i++) {
+				expected += w(j, i) * e(i, k);
+			}
+			if (back(j, k) != expected) {
+				throw std::runtime_error("Matrix test failed");
+			}
+		}
+		for (unsigned int i = 0; i < 5; i++) {
+			float expected = 1.0f;
+			for (unsigned int k = 0; k < 6; k++) {
+				expected += x(j, k) * e(i, k);
+			}
+			if (outer(j, i) != expected || wt(i, j) != w(j, i)) {
+				throw std::runtime_error("Matrix test failed");
+			}
+		}
+	}
+	std::cout << "Matrix test_4 passed" << std::endl;
+
+	// rows [2, 5) of every column, the rows around them stay untouched
+	Matrix2D<float> full({ 9, 4 });
+	Matrix2D<float> part({ 3, 4 });
+	for (unsigned int k = 0; k < 4; k++) {
+		for (unsigned int i = 0; i < 3; i++) {
+			part(i, k) = (float)(i + 10 * k);
+		}
+	}
+	full.setAll(-1.0f);
+	const MatrixView2D<float> rows = full.range(2, 3);
+	rows.setAll(2.0f);
+	rows.add(part);
+	for (unsigned int k = 0; k < 4; k++) {
+		for (unsigned int i = 0; i < 9; i++) {
+			const float expected = (i >= 2 && i < 5) ? 2.0f + part(i - 2, k) : -1.0f;
+			if (rows.getDimension(0) != 3 || full(i, k) != expected) {
+				throw std::runtime_error("Matrix test failed");
+			}
+		}
+	}
+	full.range(6, 3).copyFrom(rows);
+	part.copyFrom(full.range(6, 3));
+	for (unsigned int k = 0; k < 4; k++) {
+		for (unsigned int i = 0; i < 3; i++) {
+			if (part(i, k) != full(i + 2, k) || full(i + 6, k) != full(i + 2, k) || full(5, k) != -1.0f) {
+				throw std::runtime_error("Matrix test failed");
+			}
+		}
+	}
+	std::cout << "Matrix test_5 passed" << std::endl;
 }
 
@@ -6,14 +6,16 @@
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <memory>
+#include <numeric>
+#include <atomic>
 
 #include "Matrix.hpp"
 #include "ThreadPool.hpp"
 #include "Layer.hpp"
-
-#ifndef THREAD_POOL_SIZE
-#define THREAD_POOL_SIZE 0
-#endif
+#include "Optimizer.hpp"
+#include "Loss.hpp"
+#include "InferenceNetwork.hpp"
 
 struct TrainingData {
 	Matrix1D<float> inputs;
@@ -34,92 +36,133 @@ struct TrainingData {
 	}
 };
 
+enum class TrainingMode {
+	// gradients of all samples of a batch are reduced before the parameters are updated once
+	Synchronous,
+	// threads update the shared parameters after each of their own mini-batches without any locking, reads of parameters
+	// other threads are writing only see them a little stale or lose a single update, which stochastic gradient descent
+	// tolerates, in exchange the threads never wait for each other
+	// only optimizers without state, i.e. SGD, are supported, momentum or moment estimates updated by several threads at once
+	// would be corrupted, training throws std::invalid_argument for other optimizers
+	// every mini-batch ends with an update that reads and writes all parameters, as the gradients of dense layers are dense,
+	// so mini-batches have to be large enough for their propagation to outweigh that pass, see setHogwildMiniBatchSize
+	// the threads only wait for each other at the end of trainBatch, so a call should pass a long stream of samples
+	// instead of a single batch
+	Hogwild
+};
+
 class Network {
 public:
-	Network(const std::initializer_list<int>& layersSizes) : learningRate(0.1f), threadPool(THREAD_POOL_SIZE), batchSize(std::max<int>(THREAD_POOL_SIZE, 1)) {
+	// maxBatchSize - number of samples propagated together by trainBatch, larger batches are split into chunks of this size
+	// threadCount - number of threads training a batch, 0 uses all hardware threads, 1 trains on the calling thread
+	// slotCount - number of gradient accumulation slots, 0 uses one per thread, batchId passed to train has to be below it
+	Network(const std::initializer_list<int>& layersSizes, unsigned int maxBatchSize = 32, unsigned int threadCount = 0, unsigned int slotCount = 0)
+		: Network(layersSizes, {}, maxBatchSize, threadCount, slotCount) {}
+
+	// activations - activation of every layer except the input one, sigmoid is used when empty
+	Network(const std::initializer_list<int>& layersSizes, const std::initializer_list<Activation>& activations, unsigned int maxBatchSize = 32,
+		unsigned int threadCount = 0, unsigned int slotCount = 0) :
+		threadCount(resolveThreadCount(threadCount)), threadPool((this->threadCount > 1) ? this->threadCount : 0), learningRate(0.1f),
+		slotCount(std::max(slotCount, this->threadCount)), maxBatchSize(std::max(maxBatchSize, this->slotCount)), optimizer(std::make_unique<SGD>()) {
+		if (activations.size() != 0 && activations.size() + 1 != layersSizes.size()) {
+			throw std::invalid_argument("Activation count has to match the count of non-input layers");
+		}
+		this->activations.push_back(Activation::Sigmoid);
+		for (Activation activation : activations) {
+			this->activations.push_back(activation);
+		}
+		this->activations.resize(layersSizes.size(), Activation::Sigmoid);
+
 		this->layerCount = layersSizes.size();
 		this->layers = new Layer*[layerCount];
 		int i = 0;
 		for (auto it = layersSizes.begin(); it < layersSizes.end(); it++) {
 			int nextLayerSize = (i + 1 >= layerCount) ? 0 : *(it + 1);
-			Layer* layer = new Layer(*it, nextLayerSize, batchSize);
+			Layer* layer = new Layer(*it, nextLayerSize, this->slotCount, this->maxBatchSize, this->activations[i]);
 			layers[i] = layer;
 			i++;
+
+			// smallest sample count whose columns in this layer span whole cache lines
+			const unsigned int perLine = cacheLineSize / sizeof(float);
+			sampleAlignment = std::lcm(sampleAlignment, perLine / std::gcd(perLine, (unsigned int)layer->getNeuronCount()));
 		}
 		resetErrorSums();
 	}
 
 	void setInputs(const TrainingData& data, unsigned int batch) {
-		*layers[0]->getInputs()(batch) = data.inputs;
-		*layers[0]->getOutputs()(batch) = data.inputs;
+		layers[0]->getInputs()(batch).copyFrom(data.inputs);
+		layers[0]->getOutputs()(batch).copyFrom(data.inputs);
 	}
 
 	void propagateForward(unsigned int batch) {
-		for (int layer = 1; layer < layerCount; layer++) {
-			Layer* currentLayer = layers[layer];
-			Layer* previousLayer = layers[layer - 1];
+		propagateForward(batch, 1);
+	}
 
-			multiplyAndAdd(previousLayer->getWeights(), *previousLayer->getOutputs()(batch), currentLayer->getBiases(), *currentLayer->getInputs()(batch));
-			currentLayer->getOutputs().applyFunction(currentLayer->getInputs(), &Network::sigmoid);
-		}
+	// propagates samples stored in columns [firstBatch, firstBatch + count) of the layers at once
+	// layers with at least getParallelLayerThreshold() weights have their neurons split across the training threads
+	void propagateForward(unsigned int firstBatch, unsigned int count) {
+		propagateForward(firstBatch, count, true);
+	}
+
+	// propagates samples read straight from the caller's memory into columns [firstBatch, firstBatch + inputs.count) of the
+	// layers after the input one, which is left untouched, byte inputs are normalized inside the first matrix product
+	void propagateForward(const InputBatch& inputs, unsigned int firstBatch) {
+		propagateForward(firstBatch, inputs.count, true, &inputs);
 	}
 
 	void propagateError(const TrainingData& targetData, unsigned int batch) {
-		for (int layer = layerCount - 1; layer > 0; layer--) {
-			Layer* currentLayer = layers[layer];
-			Layer* nextLayer = layers[layer + 1];
-			Layer* previousLayer = layers[layer - 1];
-			
-			for (int iNeuron = 0; iNeuron < currentLayer->getNeuronCount(); iNeuron++) {
-				float errorSum = 0.0f;
-				if (layer == layerCount - 1) {
-					errorSum = targetData.outputs(iNeuron) - currentLayer->getOutputs()(iNeuron, batch);
-				}
-				else{
-					for (int iNextNeuron = 0; iNextNeuron < nextLayer->getNeuronCount(); iNextNeuron++) {
-						errorSum += nextLayer->getErrors()(iNextNeuron, batch) * currentLayer->getWeights()(iNeuron, iNextNeuron);
-					}
-				}
-				errorSum *= sigmoidDerivative(currentLayer->getInputs()(iNeuron, batch));
-				currentLayer->getErrors()(iNeuron, batch) = errorSum;
+		propagateError(targetData, batch, batch);
+	}
 
-				// sum errors for bias and weights
-				currentLayer->getErrorsSums()(iNeuron, batch) += errorSum;
-				for (int iPrevNeuron = 0; iPrevNeuron < previousLayer->getNeuronCount(); iPrevNeuron++) {
-					previousLayer->getWeightErrorsSums()(iPrevNeuron, iNeuron, batch) += errorSum * previousLayer->getOutputs()(iPrevNeuron, batch);
-				}
-			}
-		}
+	// sample - column holding the propagated sample, batch - slot the errors are accumulated in
+	void propagateError(const TrainingData& targetData, unsigned int sample, unsigned int batch) {
+		propagateError(&targetData, sample, 1, batch);
+	}
+
+	// targetData[i] is the target of the sample in column firstSample + i
+	void propagateError(const TrainingData* targetData, unsigned int firstSample, unsigned int count, unsigned int batch) {
+		backpropagate([targetData](unsigned int iSample) { return targetData[iSample].outputs.getData(); }, firstSample, count, batch);
 	}
 
+	// errors of samples propagated from inputs read from the caller's memory, see propagateForward, targets holds
+	// inputs.count samples of output size floats one after another
+	void propagateError(const float* targets, const InputBatch& inputs, unsigned int firstSample, unsigned int batch) {
+		const unsigned int outputSize = layers[layerCount - 1]->getNeuronCount();
+		backpropagate([targets, outputSize](unsigned int iSample) { return targets + iSample * outputSize; }, firstSample, inputs.count, batch, &inputs);
+	}
+
+	// reduces the error sums of all slots, updates the parameters and zeroes the error sums in a single pass over every buffer
+	// the buffers are packed into blocks that are spread over the threads, networks fitting in a single block are updated
+	// on the calling thread, as waking the workers would take longer than the update
 	void updateWeightsAndBiases() {
-		for (int batch = 0; batch < batchSize; batch++) {
-			for (int layer = 1; layer < layerCount; layer++) {
-				Layer* currentLayer = layers[layer];
-				Layer* previousLayer = layers[layer - 1];
-
-				for (int iNeuron = 0; iNeuron < currentLayer->getNeuronCount(); iNeuron++) {
-					for (int iPrevNeuron = 0; iPrevNeuron < previousLayer->getNeuronCount(); iPrevNeuron++) {
-						float delta = previousLayer->getWeightErrorsSums()(iPrevNeuron, iNeuron, batch);
-						previousLayer->getWeights()(iPrevNeuron, iNeuron) += delta * this->learningRate;
-					}
-					currentLayer->getBiases()(iNeuron) += currentLayer->getErrorsSums()(iNeuron, batch) * this->learningRate;
-				}
+		optimizer->beginStep();
+		const unsigned int blockCount = prepareParameterBuffers();
+
+		auto updateBlock = [this](int block, int) {
+			for (unsigned int i = updateBlocks[block]; i < updateBlocks[block + 1]; i++) {
+				const UpdateSegment& segment = updateSegments[i];
+				const ParameterBuffer& buffer = parameterBuffers[segment.buffer];
+				optimizer->update(segment.buffer + 2, buffer.parameters, buffer.errorSums, buffer.slotStride, slotCount, segment.first,
+					segment.count, learningRate);
 			}
+		};
+		if (blockCount == 1) {
+			updateBlock(0, 0);
 		}
+		else {
+			threadPool.parallelFor(0, blockCount, 1, updateBlock);
+		}
+
+		for (int layer = 0; layer < layerCount - 1; layer++) {
+			layers[layer]->updateTransposedWeights();
+		}
+		frozenNetwork.reset();
 	}
 
 	void resetErrorSums() {
-		for (int batch = 0; batch < batchSize; batch++) {
-			for (int layer = 0; layer < layerCount; layer++) {
-				Layer* currentLayer = layers[layer];
-				for (int iNeuron = 0; iNeuron < currentLayer->getNeuronCount(); iNeuron++) {
-					currentLayer->getErrorsSums()(iNeuron, batch) = 0.0f;
-					for (int iWeight = 0; iWeight < currentLayer->getOutputSize(); iWeight++) {
-						currentLayer->getWeightErrorsSums()(iNeuron, iWeight, batch) = 0.0f;
-					}
-				}
-			}
+		for (int layer = 0; layer < layerCount; layer++) {
+			layers[layer]->getWeightErrorsSums().setAll(0.0f);
+			layers[layer]->getErrorsSums().setAll(0.0f);
 		}
 	}
 
@@ -129,43 +172,55 @@ public:
 		propagateError(data, batchId);
 		if (endOfBatch) {
 			updateWeightsAndBiases();
-			resetErrorSums();
 		}
 	}
 
 	void trainBatch(const std::vector<TrainingData>& data) {
-		if (THREAD_POOL_SIZE > 0) {
-			for (int i = 0; i < data.size(); i++) {
-				threadPool.addJob([this, &data, i](int a, int threadId) {
-					train(data[i], false, threadId);
-				}, 1);
-			}
-			threadPool.wait();
-		}
-		else {
-			for (int i = 0; i < data.size(); i++) {
-				train(data[i], false, 0);
-			}
-		}
+		trainRanges(data.size(), [this, &data](unsigned int sample, unsigned int column, unsigned int count, unsigned int slot) {
+			trainSamples(&data[sample], column, count, slot);
+		});
+	}
 
-		updateWeightsAndBiases();
-		resetErrorSums();
+	// trains on samples read straight from the caller's memory, e.g. a memory-mapped dataset, instead of copies in TrainingData
+	// targets holds inputs.count samples of output size floats one after another
+	void trainBatch(const InputBatch& inputs, const float* targets) {
+		const unsigned int inputSize = layers[0]->getNeuronCount();
+		const unsigned int outputSize = layers[layerCount - 1]->getNeuronCount();
+		trainRanges(inputs.count, [this, &inputs, targets, inputSize, outputSize](unsigned int sample, unsigned int column, unsigned int count, unsigned int slot) {
+			const InputBatch range = inputs.slice(sample, count, inputSize);
+			propagateForward(column, count, false, &range);
+			propagateError(targets + sample * outputSize, range, column, slot);
+		});
 	}
 
 	float getError(const TrainingData& data, unsigned int batch) {
-		float error = 0.0f;
-		const int neuronCount = layers[layerCount - 1]->getNeuronCount();
-		for (int i = 0; i < neuronCount; i++) {
-			float delta = data.outputs(i) - layers[layerCount - 1]->getOutputs()(i, batch);
-			error += delta * delta;
-		}
-		return error / neuronCount;
+		Layer* outputLayer = layers[layerCount - 1];
+		return computeLoss(loss, outputLayer->getActivation(), outputLayer->getOutputs().dataAt(0, batch), data.outputs.getData(), outputLayer->getNeuronCount());
 	}
 
 	Layer* getOutputLayer() {
 		return layers[layerCount - 1];
 	}
 
+	// copy of the current weights, biases and activations without any of the training buffers
+	InferenceNetwork freeze() {
+		InferenceNetwork network(layers, layerCount);
+		network.setParallelLayerThreshold(parallelLayerThreshold);
+		return network;
+	}
+
+	// predicts count samples with the current parameters on the training threads, see InferenceNetwork::predictBatch
+	// the parameters are frozen on the first call after they were updated or loaded and the copy is reused until the next
+	// update, parameters changed directly through the layers are only seen after that
+	void predictBatch(const float* inputs, unsigned int count, float* outputs) {
+		getFrozenNetwork().predictBatch(inputs, count, outputs, &threadPool);
+	}
+
+	// predicts samples read from the caller's memory, byte inputs are normalized inside the first layer's matrix product
+	void predictBatch(const InputBatch& inputs, float* outputs) {
+		getFrozenNetwork().predictBatch(inputs, outputs, &threadPool);
+	}
+
 	void setLearningRate(float learningRate) {
 		this->learningRate = learningRate;
 	}
@@ -174,6 +229,68 @@ public:
 		return learningRate;
 	}
 
+	unsigned int getThreadCount() {
+		return threadCount;
+	}
+
+	unsigned int getSlotCount() {
+		return slotCount;
+	}
+
+	unsigned int getMaxBatchSize() {
+		return maxBatchSize;
+	}
+
+	// cross-entropy requires softmax or sigmoid output layer, mean squared error is used by default
+	void setLoss(Loss loss) {
+		checkLoss(loss, layers[layerCount - 1]->getActivation());
+		this->loss = loss;
+	}
+
+	Loss getLoss() {
+		return loss;
+	}
+
+	// weights a layer needs to have its neurons split across the threads when samples are propagated outside of trainBatch,
+	// so a single sample through wide layers is not limited to one core
+	void setParallelLayerThreshold(unsigned int parallelLayerThreshold) {
+		this->parallelLayerThreshold = parallelLayerThreshold;
+		if (frozenNetwork) {
+			frozenNetwork->setParallelLayerThreshold(parallelLayerThreshold);
+		}
+	}
+
+	unsigned int getParallelLayerThreshold() {
+		return parallelLayerThreshold;
+	}
+
+	// synchronous training is used by default, see TrainingMode
+	void setTrainingMode(TrainingMode trainingMode) {
+		this->trainingMode = trainingMode;
+	}
+
+	TrainingMode getTrainingMode() {
+		return trainingMode;
+	}
+
+	// samples every thread propagates between its updates in Hogwild training, 32 by default, independent of the thread count
+	// and of maxBatchSize, the layers grow to hold the mini-batches of all threads on the first Hogwild batch
+	void setHogwildMiniBatchSize(unsigned int hogwildMiniBatchSize) {
+		if (hogwildMiniBatchSize == 0) {
+			throw std::invalid_argument("Hogwild mini-batch size has to be positive");
+		}
+		this->hogwildMiniBatchSize = hogwildMiniBatchSize;
+	}
+
+	unsigned int getHogwildMiniBatchSize() {
+		return hogwildMiniBatchSize;
+	}
+
+	// replaces the optimizer used to update weights and biases, SGD is used by default
+	void setOptimizer(std::unique_ptr<Optimizer> optimizer) {
+		this->optimizer = std::move(optimizer);
+	}
+
 	void save(const char* path) {
 		std::ofstream file(path, std::ios::binary);
 		if (!file.is_open()) {
@@ -217,9 +334,12 @@ public:
 		delete[] layers;
 
 		std::ifstream file(path, std::ios::binary);
+		optimizer->reset();
+		frozenNetwork.reset();
 
 		file.read((char*)&layerCount, sizeof(int));
 		layers = new Layer*[layerCount];
+		sampleAlignment = 1;
 		for (int iLayer = 0; iLayer < layerCount; iLayer++) {
 			int neuronCount;
 			file.read((char*)&neuronCount, sizeof(int));
@@ -227,7 +347,13 @@ public:
 			int weightCount;
 			file.read((char*)&weightCount, sizeof(int));
 
-			layers[iLayer] = new Layer(neuronCount, weightCount, batchSize);
+			// the model file does not store activations, layers keep the ones the network was created with
+			const Activation activation = (iLayer < (int)activations.size()) ? activations[iLayer] : Activation::Sigmoid;
+			layers[iLayer] = new Layer(neuronCount, weightCount, slotCount, maxBatchSize, activation);
+
+			// the loaded layer sizes may differ from the ones the network was created with
+			const unsigned int perLine = cacheLineSize / sizeof(float);
+			sampleAlignment = std::lcm(sampleAlignment, perLine / std::gcd(perLine, (unsigned int)layers[iLayer]->getNeuronCount()));
 
 			std::cout << "Layer " << iLayer << ": " << neuronCount << " neurons, " << weightCount << " weights\n";
 
@@ -242,7 +368,9 @@ public:
 					}
 				}
 			}
+			layers[iLayer]->updateTransposedWeights();
 		}
+		resetErrorSums();
 
 		file.close();
 		std::cout << "Loaded network from " << path << '\n';
@@ -256,18 +384,246 @@ public:
 	}
 
 private:
+	// parameters updated by one task of updateWeightsAndBiases, small enough for the reduced gradients and the optimizer
+	// state of a block to stay in cache
+	static constexpr unsigned int updateBlockSize = 16 * 1024;
+
+	struct ParameterBuffer {
+		float* parameters;
+		float* errorSums;
+		unsigned int slotStride;
+		unsigned int size;
+	};
+
+	// range of a parameter buffer, a block of updateWeightsAndBiases is a run of segments
+	struct UpdateSegment {
+		unsigned int buffer;
+		unsigned int first;
+		unsigned int count;
+	};
+
+	unsigned int threadCount;
 	ThreadPool threadPool;
 
 	Layer** layers;
 	int layerCount;
 	float learningRate;
-	unsigned int batchSize;
+	// gradients of samples trained by different threads are accumulated in separate slots and reduced by the optimizer
+	unsigned int slotCount;
+	unsigned int maxBatchSize;
+	unsigned int sampleAlignment = 1;
+	std::vector<Activation> activations;
+	std::unique_ptr<Optimizer> optimizer;
+	Loss loss = Loss::MeanSquaredError;
+	TrainingMode trainingMode = TrainingMode::Synchronous;
+	unsigned int hogwildMiniBatchSize = 32;
+	unsigned int parallelLayerThreshold = defaultParallelLayerThreshold;
+	std::vector<ParameterBuffer> parameterBuffers;
+	std::vector<UpdateSegment> updateSegments;
+	// block i updates updateSegments[updateBlocks[i], updateBlocks[i + 1])
+	std::vector<unsigned int> updateBlocks;
+	// copy of the parameters predictBatch uses, dropped whenever they change
+	std::unique_ptr<InferenceNetwork> frozenNetwork;
+
+	const InferenceNetwork& getFrozenNetwork() {
+		if (!frozenNetwork) {
+			frozenNetwork = std::make_unique<InferenceNetwork>(freeze());
+		}
+		return *frozenNetwork;
+	}
+
+	static unsigned int resolveThreadCount(unsigned int threadCount) {
+		if (threadCount == 0) {
+			threadCount = std::thread::hardware_concurrency();
+		}
+		return std::max(threadCount, 1u);
+	}
+
+	// splitLayers - large layers are split across the threads, the workers of the pool propagate their own samples without it
+	// batchInputs - samples the first layer reads instead of the outputs of the input layer
+	void propagateForward(unsigned int firstBatch, unsigned int count, bool splitLayers, const InputBatch* batchInputs = nullptr) {
+		for (int layer = 1; layer < layerCount; layer++) {
+			Layer* currentLayer = layers[layer];
+			Layer* previousLayer = layers[layer - 1];
 
-	static float sigmoid(float x) {
-		return 1.0f / (1.0f + std::exp(-x));
+			const MatrixView2D<float> inputs = currentLayer->getInputs().slice(firstBatch, count);
+			const MatrixView2D<float> outputs = currentLayer->getOutputs().slice(firstBatch, count);
+			const MatrixView2D<float> previousOutputs = (layer == 1 && batchInputs != nullptr && batchInputs->floats != nullptr)
+				? batchInputs->getColumns(previousLayer->getNeuronCount()) : previousLayer->getOutputs().slice(firstBatch, count);
+			if (layer == 1 && batchInputs != nullptr && batchInputs->bytes != nullptr) {
+				// not split, every range would normalize all of the bytes again
+				multiplyAndAdd(previousLayer->getWeights(), batchInputs->getByteColumns(previousLayer->getNeuronCount()), currentLayer->getBiases(), inputs);
+				applyActivation(currentLayer->getActivation(), inputs, outputs);
+			}
+			else if (splitLayers && threadCount > 1 && previousLayer->getWeights().getSize() >= parallelLayerThreshold) {
+				propagateParallel(threadPool, previousLayer->getWeights(), previousOutputs, currentLayer->getBiases(), currentLayer->getActivation(), inputs, outputs);
+			}
+			else {
+				multiplyAndAdd(previousLayer->getWeights(), previousOutputs, currentLayer->getBiases(), inputs);
+				applyActivation(currentLayer->getActivation(), inputs, outputs);
+			}
+		}
 	}
 
-	static float sigmoidDerivative(float x) {
-		return sigmoid(x) * (1.0f - sigmoid(x));
+	// trains on samples[0, count), using layer columns [first, first + count) and error slot batch
+	void trainSamples(const TrainingData* samples, unsigned int first, unsigned int count, unsigned int batch) {
+		for (unsigned int i = 0; i < count; i++) {
+			setInputs(samples[i], first + i);
+		}
+		propagateForward(first, count, false);
+		propagateError(samples, first, count, batch);
+	}
+
+	// target(i) returns the target outputs of the sample in column firstSample + i, inputs - samples the first layer was
+	// propagated from instead of the outputs of the input layer
+	template <typename Targets>
+	void backpropagate(Targets target, unsigned int firstSample, unsigned int count, unsigned int batch, const InputBatch* inputs = nullptr) {
+		for (int layer = layerCount - 1; layer > 0; layer--) {
+			Layer* currentLayer = layers[layer];
+			Layer* previousLayer = layers[layer - 1];
+
+			const MatrixView2D<float> errors = currentLayer->getErrors().slice(firstSample, count);
+			const MatrixView2D<float> outputs = currentLayer->getOutputs().slice(firstSample, count);
+			if (layer == layerCount - 1) {
+				for (unsigned int iSample = 0; iSample < count; iSample++) {
+					computeOutputErrors(outputs.dataAt(0, iSample), target(iSample), errors.dataAt(0, iSample), currentLayer->getNeuronCount());
+				}
+			}
+			else {
+				const MatrixView2D<float> nextErrors = layers[layer + 1]->getErrors().slice(firstSample, count);
+#ifdef KEEP_TRANSPOSED_WEIGHTS
+				multiply(currentLayer->getTransposedWeights(), nextErrors, errors);
+#else
+				multiplyTransposed(currentLayer->getWeights(), nextErrors, errors);
+#endif
+			}
+
+			if (layer != layerCount - 1 || loss != Loss::CrossEntropy) {
+				applyActivationDerivative(currentLayer->getActivation(), outputs, errors);
+			}
+
+			// sum errors for bias and weights
+			for (unsigned int iSample = 0; iSample < count; iSample++) {
+				currentLayer->getErrorsSums(batch) += errors(iSample);
+			}
+			if (layer == 1 && inputs != nullptr && inputs->bytes != nullptr) {
+				addOuterProducts(inputs->getByteColumns(previousLayer->getNeuronCount()), errors, previousLayer->getWeightErrorsSums(batch));
+			}
+			else if (layer == 1 && inputs != nullptr) {
+				addOuterProducts(inputs->getColumns(previousLayer->getNeuronCount()), errors, previousLayer->getWeightErrorsSums(batch));
+			}
+			else {
+				addOuterProducts(previousLayer->getOutputs().slice(firstSample, count), errors, previousLayer->getWeightErrorsSums(batch));
+			}
+		}
+	}
+
+	// trainRange(sample, column, count, slot) trains on samples [sample, sample + count) of the batch in layer columns
+	// [column, column + count), accumulating their errors in slot
+	template <typename TrainRange>
+	void trainRanges(unsigned int sampleCount, const TrainRange& trainRange) {
+		if (trainingMode == TrainingMode::Hogwild) {
+			trainBatchHogwild(sampleCount, trainRange);
+			return;
+		}
+
+		for (unsigned int offset = 0; offset < sampleCount; offset += maxBatchSize) {
+			const unsigned int count = std::min<unsigned int>(sampleCount - offset, maxBatchSize);
+			// every chunk propagates a contiguous range of samples, so the weights are reused across the whole range
+			// chunks start at multiples of sampleAlignment when there are enough samples, so the columns written by different
+			// threads never share a cache line
+			const unsigned int alignment = (count >= threadCount * sampleAlignment) ? sampleAlignment : 1;
+			const unsigned int units = (count + alignment - 1) / alignment;
+			const unsigned int chunks = std::min(threadCount, units);
+			threadPool.parallelFor(0, chunks, 1, [&trainRange, offset, count, chunks, units, alignment](int chunk, int threadId) {
+				const unsigned int first = units * chunk / chunks * alignment;
+				const unsigned int last = std::min(units * (chunk + 1) / chunks * alignment, count);
+				trainRange(offset + first, first, last - first, threadId);
+			});
+		}
+
+		updateWeightsAndBiases();
+	}
+
+	// collects the weights and biases of all layers into parameterBuffers, creates their optimizer state and returns the number
+	// of update blocks, buffer i is parameter i + 2 of the optimizer, layer * 2 for weights and layer * 2 + 1 for biases
+	// consecutive buffers share a block until it holds updateBlockSize parameters, so the biases are updated together with
+	// the end of the weights before them instead of as tasks of their own
+	unsigned int prepareParameterBuffers() {
+		parameterBuffers.clear();
+		updateSegments.clear();
+		updateBlocks.assign(1, 0);
+		for (int layer = 1; layer < layerCount; layer++) {
+			Layer* currentLayer = layers[layer];
+			Layer* previousLayer = layers[layer - 1];
+
+			Matrix2D<float, WeightAllocator>& weightErrorsSums = previousLayer->getWeightErrorsSums();
+			parameterBuffers.push_back({ previousLayer->getWeights().getData(), weightErrorsSums.getData(), weightErrorsSums.getStride(1),
+				previousLayer->getWeights().getSize() });
+			Matrix2D<float>& errorsSums = currentLayer->getErrorsSums();
+			parameterBuffers.push_back({ currentLayer->getBiases().getData(), errorsSums.getData(), errorsSums.getStride(1),
+				currentLayer->getNeuronCount() });
+		}
+		unsigned int blockFill = 0;
+		for (unsigned int i = 0; i < parameterBuffers.size(); i++) {
+			const unsigned int size = parameterBuffers[i].size;
+			optimizer->prepare(i + 2, size);
+			for (unsigned int first = 0; first < size;) {
+				const unsigned int count = std::min(size - first, updateBlockSize - blockFill);
+				updateSegments.push_back({ i, first, count });
+				first += count;
+				// counted in whole cache lines, so a buffer is only cut at line boundaries and blocks never write the same line
+				blockFill += padToCacheLine<float>(count);
+				if (blockFill >= updateBlockSize) {
+					updateBlocks.push_back(updateSegments.size());
+					blockFill = 0;
+				}
+			}
+		}
+		if (blockFill > 0) {
+			updateBlocks.push_back(updateSegments.size());
+		}
+		return updateBlocks.size() - 1;
+	}
+
+	// every thread owns a range of columns and trains mini-batches of that many samples, updating the shared parameters
+	// from its own slot right after each of them without waiting for the other threads, the threads take mini-batches
+	// from the whole batch until it runs out, so they only join once per call
+	template <typename TrainRange>
+	void trainBatchHogwild(unsigned int sampleCount, const TrainRange& trainRange) {
+		if (!optimizer->isStateless()) {
+			throw std::invalid_argument("Hogwild training only supports optimizers without state, such as SGD");
+		}
+		optimizer->beginStep();
+		prepareParameterBuffers();
+
+		unsigned int columns = hogwildMiniBatchSize;
+		if (columns >= sampleAlignment) {
+			columns = columns / sampleAlignment * sampleAlignment;
+		}
+		const unsigned int miniBatches = (sampleCount + columns - 1) / columns;
+		const unsigned int workers = std::min(threadCount, miniBatches);
+		for (int layer = 0; layer < layerCount; layer++) {
+			layers[layer]->reserveSamples(workers * columns);
+		}
+		std::atomic<unsigned int> nextMiniBatch = 0;
+
+		threadPool.parallelFor(0, workers, 1, [this, &trainRange, &nextMiniBatch, sampleCount, columns, miniBatches](int thread, int threadId) {
+			for (unsigned int miniBatch = nextMiniBatch++; miniBatch < miniBatches; miniBatch = nextMiniBatch++) {
+				const unsigned int first = miniBatch * columns;
+				trainRange(first, thread * columns, std::min(columns, sampleCount - first), threadId);
+				for (unsigned int i = 0; i < parameterBuffers.size(); i++) {
+					const ParameterBuffer& buffer = parameterBuffers[i];
+					optimizer->update(i + 2, buffer.parameters, buffer.errorSums + threadId * buffer.slotStride, buffer.slotStride, 1,
+						0, buffer.size, learningRate);
+				}
+			}
+		});
+
+		// the transposed weights stay stale during the batch, like the weights other threads have not written yet
+		for (int layer = 0; layer < layerCount - 1; layer++) {
+			layers[layer]->updateTransposedWeights();
+		}
+		frozenNetwork.reset();
 	}
 };
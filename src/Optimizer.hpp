@@ -0,0 +1,175 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "Matrix.hpp"
+
+// updates parameters from the error sums accumulated during a batch
+// error sums point in the direction the parameters should move (target - output convention of Network)
+class Optimizer {
+public:
+	virtual ~Optimizer() {}
+
+	// called once per batch, before the parameters are updated
+	virtual void beginStep() {}
+
+	// true when a step only depends on the gradients and keeps nothing between batches, only such optimizers can be used by
+	// Hogwild training, where threads update the same parameters at once
+	virtual bool isStateless() const {
+		return false;
+	}
+
+	// parameters += step computed from the error sums of slotCount slots stored slotStride floats apart
+	// parameterId identifies the parameter buffer, so the optimizer state is kept per buffer between batches
+	// the error sums are zeroed after they are read, so they are ready for the next batch
+	void update(unsigned int parameterId, float* parameters, float* errorSums, unsigned int slotStride, unsigned int slotCount,
+		unsigned int size, float learningRate) {
+		prepare(parameterId, size);
+		update(parameterId, parameters, errorSums, slotStride, slotCount, 0, size, learningRate);
+	}
+
+	// updates parameters [first, first + count) of a buffer prepared with prepare, different ranges of the same buffer
+	// can be updated by different threads at once
+	// the slots are reduced block by block into a buffer that stays in cache and the step is applied right after,
+	// so every parameter, error sum and state value is read and written once per batch
+	void update(unsigned int parameterId, float* parameters, float* errorSums, unsigned int slotStride, unsigned int slotCount,
+		unsigned int first, unsigned int count, float learningRate) {
+		float** state = statePointers[parameterId].data();
+		const kernels::KernelTable& kernelTable = kernels::get();
+
+		float gradients[blockSize];
+		float* blockState[maxStateCount];
+		for (unsigned int offset = first; offset < first + count; offset += blockSize) {
+			const unsigned int size = std::min(blockSize, first + count - offset);
+			std::copy(errorSums + offset, errorSums + offset + size, gradients);
+			std::fill(errorSums + offset, errorSums + offset + size, 0.0f);
+			for (unsigned int slot = 1; slot < slotCount; slot++) {
+				float* slotSums = errorSums + slot * slotStride + offset;
+				kernelTable.add(gradients, slotSums, size);
+				std::fill(slotSums, slotSums + size, 0.0f);
+			}
+			for (unsigned int i = 0; i < getStateCount(); i++) {
+				blockState[i] = state[i] + offset;
+			}
+			step(parameters + offset, blockState, gradients, size, learningRate);
+		}
+	}
+
+	// creates the state of a parameter buffer of size parameters, if it does not exist yet
+	// has to be called before ranges of the buffer are updated
+	void prepare(unsigned int parameterId, unsigned int size) {
+		if (parameterId >= states.size()) {
+			states.resize(parameterId + 1);
+			statePointers.resize(parameterId + 1);
+		}
+		std::vector<Matrix1D<float>>& state = states[parameterId];
+		if (state.size() != getStateCount() || (state.size() > 0 && state[0].getSize() != size)) {
+			state.clear();
+			statePointers[parameterId].clear();
+			for (unsigned int i = 0; i < getStateCount(); i++) {
+				state.emplace_back(std::array<unsigned int, 1>{ size });
+				state.back().setAll(0.0f);
+				statePointers[parameterId].push_back(state.back().getData());
+			}
+		}
+	}
+
+	// drops the state of all parameters, has to be called when the parameter buffers change
+	void reset() {
+		states.clear();
+		statePointers.clear();
+	}
+
+protected:
+	static constexpr unsigned int blockSize = 1024;
+	static constexpr unsigned int maxStateCount = 2;
+
+	// number of state values kept per parameter
+	virtual unsigned int getStateCount() const = 0;
+
+	virtual void step(float* parameters, float** state, const float* gradients, unsigned int size, float learningRate) = 0;
+
+private:
+	std::vector<std::vector<Matrix1D<float>>> states;
+	std::vector<std::vector<float*>> statePointers;
+};
+
+// plain stochastic gradient descent
+class SGD : public Optimizer {
+public:
+	bool isStateless() const override {
+		return true;
+	}
+
+protected:
+	unsigned int getStateCount() const override {
+		return 0;
+	}
+
+	void step(float* parameters, float**, const float* gradients, unsigned int size, float learningRate) override {
+		kernels::get().addScaledToColumns(parameters, 0, gradients, &learningRate, 0, 1, size);
+	}
+};
+
+class Momentum : public Optimizer {
+public:
+	Momentum(float momentum = 0.9f) : momentum(momentum) {}
+
+protected:
+	unsigned int getStateCount() const override {
+		return 1;
+	}
+
+	void step(float* parameters, float** state, const float* gradients, unsigned int size, float learningRate) override {
+		kernels::get().momentumStep(parameters, state[0], gradients, learningRate, momentum, size);
+	}
+
+private:
+	float momentum;
+};
+
+class RMSProp : public Optimizer {
+public:
+	RMSProp(float decay = 0.9f, float epsilon = 1e-8f) : decay(decay), epsilon(epsilon) {}
+
+protected:
+	unsigned int getStateCount() const override {
+		return 1;
+	}
+
+	void step(float* parameters, float** state, const float* gradients, unsigned int size, float learningRate) override {
+		kernels::get().rmsPropStep(parameters, state[0], gradients, learningRate, decay, epsilon, size);
+	}
+
+private:
+	float decay;
+	float epsilon;
+};
+
+class Adam : public Optimizer {
+public:
+	Adam(float beta1 = 0.9f, float beta2 = 0.999f, float epsilon = 1e-8f) : beta1(beta1), beta2(beta2), epsilon(epsilon), stepCount(0) {}
+
+	void beginStep() override {
+		stepCount++;
+	}
+
+protected:
+	unsigned int getStateCount() const override {
+		return 2;
+	}
+
+	void step(float* parameters, float** state, const float* gradients, unsigned int size, float learningRate) override {
+		// bias correction of both moments folded into the learning rate
+		const float correctedRate = learningRate * std::sqrt(1.0f - std::pow(beta2, (float)stepCount)) / (1.0f - std::pow(beta1, (float)stepCount));
+		kernels::get().adamStep(parameters, state[0], state[1], gradients, correctedRate, beta1, beta2, epsilon, size);
+	}
+
+private:
+	float beta1;
+	float beta2;
+	float epsilon;
+	unsigned int stepCount;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+// counter-based generator Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+// the numbers are a pure function of a key and a counter, so any thread can draw the numbers belonging to any sample
+// without sharing or advancing a state, and the same key and counter always give the same numbers
+namespace philox {
+	using Counter = std::array<std::uint32_t, 4>;
+	using Key = std::array<std::uint32_t, 2>;
+
+	inline Counter generate(Counter counter, Key key) {
+		constexpr std::uint32_t multiplier0 = 0xD2511F53;
+		constexpr std::uint32_t multiplier1 = 0xCD9E8D57;
+		constexpr std::uint32_t weyl0 = 0x9E3779B9;
+		constexpr std::uint32_t weyl1 = 0xBB67AE85;
+
+		for (int round = 0; round < 10; round++) {
+			const std::uint64_t product0 = (std::uint64_t)multiplier0 * counter[0];
+			const std::uint64_t product1 = (std::uint64_t)multiplier1 * counter[2];
+			counter = {
+				(std::uint32_t)(product1 >> 32) ^ counter[1] ^ key[0],
+				(std::uint32_t)product1,
+				(std::uint32_t)(product0 >> 32) ^ counter[3] ^ key[1],
+				(std::uint32_t)product0
+			};
+			key[0] += weyl0;
+			key[1] += weyl1;
+		}
+		return counter;
+	}
+}
+
+// sequence of random numbers identified by a seed and a stream, e.g. the index of a sample or of a thread
+// creating one is free, so a generator can be made for every sample, which keeps parallel data preparation reproducible
+// meets the requirements of a uniform random bit generator, so it works with std::shuffle and the std distributions
+class Random {
+public:
+	using result_type = std::uint32_t;
+
+	Random(std::uint64_t seed = 0, std::uint64_t stream = 0) : key{ (std::uint32_t)seed, (std::uint32_t)(seed >> 32) }, stream(stream) {}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()() {
+		if (bufferIndex == 4) {
+			buffer = philox::generate({ (std::uint32_t)position, (std::uint32_t)(position >> 32), (std::uint32_t)stream, (std::uint32_t)(stream >> 32) }, key);
+			position++;
+			bufferIndex = 0;
+		}
+		return buffer[bufferIndex++];
+	}
+
+	// uniform in [0, 1)
+	float nextFloat() {
+		return (float)((*this)() >> 8) * (1.0f / (1 << 24));
+	}
+
+	// uniform in [min, max)
+	float nextFloat(float min, float max) {
+		return min + nextFloat() * (max - min);
+	}
+
+	// uniform in [0, bound) without modulo bias (Lemire, "Fast Random Integer Generation in an Interval")
+	std::uint32_t nextInt(std::uint32_t bound) {
+		std::uint64_t product = (std::uint64_t)(*this)() * bound;
+		if ((std::uint32_t)product < bound) {
+			const std::uint32_t threshold = (0u - bound) % bound;
+			while ((std::uint32_t)product < threshold) {
+				product = (std::uint64_t)(*this)() * bound;
+			}
+		}
+		return product >> 32;
+	}
+
+	std::uint64_t getStream() const {
+		return stream;
+	}
+
+private:
+	philox::Key key;
+	std::uint64_t stream;
+	// index of the next block of 4 numbers
+	std::uint64_t position = 0;
+	philox::Counter buffer{};
+	unsigned int bufferIndex = 4;
+};
+
+// generator of the calling thread, every thread draws from its own stream, numbered in the order threads first use it,
+// so unlike rand() threads never contend, seeded with 0 until seedThreadRandom is called
+Random& getThreadRandom() {
+	static std::atomic<std::uint64_t> nextStream = 0;
+	thread_local Random random(0, nextStream++);
+	return random;
+}
+
+// restarts the stream of the calling thread from seed, replaces srand
+void seedThreadRandom(std::uint64_t seed) {
+	Random& random = getThreadRandom();
+	random = Random(seed, random.getStream());
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <stdexcept>
+
+#include "Random.hpp"
+
+// order in which the samples of a dataset are visited during training, sample number i of the run, counted across epochs,
+// is mapped to an index into the dataset, every epoch visits every index once in a new order
+// the order of an epoch only depends on the seed and the epoch number, so it is the same for any number of threads
+// and getIndex can be called from several threads at once, e.g. from the prepare function of a DataLoader
+// the permutation of an epoch is created once by the first thread that needs it, getIndex does not lock otherwise
+class Sampler {
+public:
+	Sampler(unsigned int count, std::uint64_t seed) : count(count), seed(seed) {
+		if (count == 0) {
+			throw std::invalid_argument("Sampler needs at least one sample");
+		}
+	}
+
+	virtual ~Sampler() {}
+
+	unsigned int getIndex(std::uint64_t sampleIndex) {
+		const std::uint64_t epoch = sampleIndex / count;
+		const unsigned int position = sampleIndex % count;
+		// seqlock read, the index is only used if the epoch was not replaced while it was read
+		Epoch& cached = epochs[epoch % 2];
+		if (cached.stamp.load(std::memory_order_acquire) == epoch + 1) {
+			const unsigned int index = cached.permutation[position].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (cached.stamp.load(std::memory_order_relaxed) == epoch + 1) {
+				return index;
+			}
+		}
+		return createEpoch(epoch, position);
+	}
+
+	unsigned int getCount() const {
+		return count;
+	}
+
+	std::uint64_t getEpoch(std::uint64_t sampleIndex) const {
+		return sampleIndex / count;
+	}
+
+protected:
+	// fills permutation with the count dataset indices in the order of an epoch, random is seeded for that epoch
+	virtual void createPermutation(Random& random, std::vector<unsigned int>& permutation) = 0;
+
+private:
+	// threads preparing samples around the end of an epoch need two epochs at once, so even and odd epochs are kept
+	// in their own slot
+	struct Epoch {
+		// epoch + 1 when the permutation is complete, 0 while it is written
+		std::atomic<std::uint64_t> stamp = 0;
+		std::unique_ptr<std::atomic<unsigned int>[]> permutation;
+	};
+
+	// creates the permutation of epoch and returns its index at position, called when it is not cached yet
+	unsigned int createEpoch(std::uint64_t epoch, unsigned int position) {
+		std::unique_lock<std::mutex> lock(mutex);
+		Epoch& cached = epochs[epoch % 2];
+		const std::uint64_t stamp = cached.stamp.load(std::memory_order_relaxed);
+		if (stamp == epoch + 1) {
+			return cached.permutation[position].load(std::memory_order_relaxed);
+		}
+
+		Random random(seed, epoch);
+		createPermutation(random, created);
+		// a thread far behind the others does not replace a newer epoch, it only uses the permutation once
+		if (stamp > epoch + 1) {
+			return created[position];
+		}
+
+		if (!cached.permutation) {
+			cached.permutation = std::make_unique<std::atomic<unsigned int>[]>(count);
+		}
+		cached.stamp.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (unsigned int i = 0; i < count; i++) {
+			cached.permutation[i].store(created[i], std::memory_order_relaxed);
+		}
+		cached.stamp.store(epoch + 1, std::memory_order_release);
+		return created[position];
+	}
+
+	unsigned int count;
+	std::uint64_t seed;
+	// taken only to create the permutation of an epoch
+	std::mutex mutex;
+	Epoch epochs[2];
+	std::vector<unsigned int> created;
+};
+
+// every epoch is a uniformly shuffled permutation of the dataset
+class ShuffledSampler : public Sampler {
+public:
+	ShuffledSampler(unsigned int count, std::uint64_t seed = 0) : Sampler(count, seed) {}
+
+protected:
+	void createPermutation(Random& random, std::vector<unsigned int>& permutation) override {
+		permutation.resize(getCount());
+		std::iota(permutation.begin(), permutation.end(), 0);
+		// Fisher-Yates
+		for (unsigned int i = getCount() - 1; i > 0; i--) {
+			std::swap(permutation[i], permutation[random.nextInt(i + 1)]);
+		}
+	}
+};
+
+// shuffles every class on its own and spreads its samples evenly over the epoch, so every batch holds the classes
+// in about the proportion they have in the dataset instead of only on average
+class StratifiedSampler : public Sampler {
+public:
+	// labels - class of every sample of the dataset
+	template <typename Label>
+	StratifiedSampler(const Label* labels, unsigned int count, std::uint64_t seed = 0) : Sampler(count, seed) {
+		for (unsigned int i = 0; i < count; i++) {
+			const unsigned int label = (unsigned int)labels[i];
+			if (label >= classes.size()) {
+				classes.resize(label + 1);
+			}
+			classes[label].push_back(i);
+		}
+	}
+
+protected:
+	void createPermutation(Random& random, std::vector<unsigned int>& permutation) override {
+		// the k-th of the n samples of a class is placed at (k + phase) / n of the epoch, with a random phase per class
+		std::vector<std::pair<float, unsigned int>> positions;
+		positions.reserve(getCount());
+		for (const std::vector<unsigned int>& classMembers : classes) {
+			// shuffled from the dataset order every time, so an epoch does not depend on the epochs created before it
+			std::vector<unsigned int> members = classMembers;
+			std::shuffle(members.begin(), members.end(), random);
+			const float phase = random.nextFloat();
+			for (unsigned int k = 0; k < members.size(); k++) {
+				positions.push_back({ (k + phase) / members.size(), members[k] });
+			}
+		}
+		std::sort(positions.begin(), positions.end());
+
+		permutation.resize(getCount());
+		for (unsigned int i = 0; i < getCount(); i++) {
+			permutation[i] = positions[i].second;
+		}
+	}
+
+private:
+	// dataset indices of the samples of every class
+	std::vector<std::vector<unsigned int>> classes;
+};
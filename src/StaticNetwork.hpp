@@ -0,0 +1,420 @@
+#pragma once
+
+#include <initializer_list>
+#include <array>
+#include <utility>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Matrix.hpp"
+#include "Activation.hpp"
+#include "Layer.hpp"
+#include "Loss.hpp"
+
+// network with layer sizes fixed at compile time, e.g. StaticNetwork<2, 30, 20, 10, 3>
+// all parameters and buffers are arrays inside the object, so there is no allocation or pointer chasing and every loop
+// has a constant trip count the compiler can unroll and vectorize, meant for small networks trained one sample at a time
+// the loops of a layer, activations included, are templates over its size and activation, which is switched on once per
+// layer, so nothing inside them goes through the runtime kernel table
+// models are saved in the same format as Network, so they can be moved between the two
+template <unsigned int... sizes>
+class StaticNetwork {
+public:
+	static constexpr int layerCount = sizeof...(sizes);
+	static constexpr std::array<unsigned int, layerCount> layerSizes = { sizes... };
+	static constexpr unsigned int inputSize = layerSizes.front();
+	static constexpr unsigned int outputSize = layerSizes.back();
+
+	static_assert(layerCount >= 2, "StaticNetwork needs an input and an output layer");
+
+	using Inputs = std::array<float, inputSize>;
+	using Outputs = std::array<float, outputSize>;
+
+	// activations - activation of every layer except the input one, sigmoid is used when empty
+	// parameters are drawn in the same order as by Network, so both start from the same weights for the same seed
+	StaticNetwork(const std::initializer_list<Activation>& activations = {}) {
+		if (activations.size() != 0 && activations.size() + 1 != layerCount) {
+			throw std::invalid_argument("Activation count has to match the count of non-input layers");
+		}
+		this->activations.fill(Activation::Sigmoid);
+		std::copy(activations.begin(), activations.end(), this->activations.begin() + 1);
+
+		for (int layer = 0; layer < layerCount; layer++) {
+			const unsigned int nextSize = (layer + 1 < layerCount) ? layerSizes[layer + 1] : 0;
+			for (unsigned int i = 0; i < layerSizes[layer]; i++) {
+				biases[neuronOffsets[layer] + i] = randomNormalizedFloat();
+				for (unsigned int j = 0; j < nextSize; j++) {
+					weights[weightOffsets[layer] + i * nextSize + j] = randomNormalizedFloat();
+				}
+			}
+		}
+		weightErrorsSums.fill(0.0f);
+		errorsSums.fill(0.0f);
+	}
+
+	void setInputs(const Inputs& inputs) {
+		std::copy(inputs.begin(), inputs.end(), outputs.begin());
+	}
+
+	void propagateForward() {
+		propagateForward(std::make_integer_sequence<int, layerCount - 1>());
+	}
+
+	// errors are accumulated until updateWeightsAndBiases is called
+	void propagateError(const Outputs& targets) {
+		propagateError(targets, std::make_integer_sequence<int, layerCount - 1>());
+	}
+
+	void updateWeightsAndBiases() {
+		for (unsigned int i = 0; i < weightCount; i++) {
+			weights[i] += learningRate * weightErrorsSums[i];
+		}
+		for (unsigned int i = 0; i < neuronCount; i++) {
+			biases[i] += learningRate * errorsSums[i];
+		}
+		weightErrorsSums.fill(0.0f);
+		errorsSums.fill(0.0f);
+	}
+
+	void train(const Inputs& inputs, const Outputs& targets, bool endOfBatch) {
+		setInputs(inputs);
+		propagateForward();
+		propagateError(targets);
+		if (endOfBatch) {
+			updateWeightsAndBiases();
+		}
+	}
+
+	Outputs predict(const Inputs& inputs) {
+		setInputs(inputs);
+		propagateForward();
+		return getOutputs();
+	}
+
+	// outputs of the last propagated sample
+	Outputs getOutputs() const {
+		Outputs result;
+		std::copy(outputs.begin() + neuronOffsets.back(), outputs.end(), result.begin());
+		return result;
+	}
+
+	// loss of the last propagated sample
+	float getError(const Outputs& targets) const {
+		return computeLoss(loss, activations.back(), &outputs[neuronOffsets.back()], targets.data(), outputSize);
+	}
+
+	void setLearningRate(float learningRate) {
+		this->learningRate = learningRate;
+	}
+
+	float getLearningRate() const {
+		return learningRate;
+	}
+
+	// cross-entropy requires softmax or sigmoid output layer, mean squared error is used by default
+	void setLoss(Loss loss) {
+		checkLoss(loss, activations.back());
+		this->loss = loss;
+	}
+
+	Loss getLoss() const {
+		return loss;
+	}
+
+	// writes the same file as Network::save
+	void save(const char* path) const {
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "Failed to open file " << path << '\n';
+			return;
+		}
+
+		const int count = layerCount;
+		file.write((char*)&count, sizeof(int));
+		for (int layer = 0; layer < layerCount; layer++) {
+			const int neuronCount = layerSizes[layer];
+			const int nextSize = (layer + 1 < layerCount) ? layerSizes[layer + 1] : 0;
+			file.write((char*)&neuronCount, sizeof(int));
+			file.write((char*)&nextSize, sizeof(int));
+			// weights of a neuron are stored next to each other, as in the file
+			for (int i = 0; i < neuronCount; i++) {
+				file.write((char*)&biases[neuronOffsets[layer] + i], sizeof(float));
+				file.write((char*)&weights[weightOffsets[layer] + i * nextSize], sizeof(float) * nextSize);
+			}
+		}
+
+		file.close();
+		std::cout << "Saved network to " << path << '\n';
+	}
+
+	// reads a model saved by Network::save or StaticNetwork::save, its layer sizes have to match the template arguments
+	// the model file does not store activations, the network keeps the ones it was created with
+	void load(const char* path) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error(std::string("Failed to open file ") + path);
+		}
+
+		int count;
+		file.read((char*)&count, sizeof(int));
+		if (count != layerCount) {
+			throw std::invalid_argument(std::string("Layer count of ") + path + " does not match the network");
+		}
+		for (int layer = 0; layer < layerCount; layer++) {
+			const int nextSize = (layer + 1 < layerCount) ? layerSizes[layer + 1] : 0;
+			int neuronCount;
+			int weightCount;
+			file.read((char*)&neuronCount, sizeof(int));
+			file.read((char*)&weightCount, sizeof(int));
+			if (neuronCount != (int)layerSizes[layer] || weightCount != nextSize) {
+				throw std::invalid_argument(std::string("Layer sizes of ") + path + " do not match the network");
+			}
+			for (int i = 0; i < neuronCount; i++) {
+				file.read((char*)&biases[neuronOffsets[layer] + i], sizeof(float));
+				file.read((char*)&weights[weightOffsets[layer] + i * nextSize], sizeof(float) * nextSize);
+			}
+		}
+		if (!file) {
+			throw std::runtime_error(std::string("Failed to read model from ") + path);
+		}
+		weightErrorsSums.fill(0.0f);
+		errorsSums.fill(0.0f);
+
+		file.close();
+		std::cout << "Loaded network from " << path << '\n';
+	}
+
+private:
+	// index of the first neuron of every layer in the per-neuron arrays
+	static constexpr std::array<unsigned int, layerCount> neuronOffsets = []() {
+		std::array<unsigned int, layerCount> offsets{};
+		for (int layer = 1; layer < layerCount; layer++) {
+			offsets[layer] = offsets[layer - 1] + layerSizes[layer - 1];
+		}
+		return offsets;
+	}();
+	static constexpr unsigned int neuronCount = neuronOffsets.back() + outputSize;
+
+	// index of the first weight leaving every layer, the output layer has none
+	static constexpr std::array<unsigned int, layerCount> weightOffsets = []() {
+		std::array<unsigned int, layerCount> offsets{};
+		for (int layer = 1; layer < layerCount; layer++) {
+			offsets[layer] = offsets[layer - 1] + layerSizes[layer - 1] * layerSizes[layer];
+		}
+		return offsets;
+	}();
+	static constexpr unsigned int weightCount = weightOffsets.back();
+
+	// weights leaving neuron i of a layer towards neuron j of the next one are at i * nextSize + j, so the weights of a neuron
+	// are contiguous as in the model file and the forward pass adds one scaled row per input neuron
+	alignas(cacheLineSize) std::array<float, weightCount> weights;
+	alignas(cacheLineSize) std::array<float, weightCount> weightErrorsSums;
+	// biases of the input layer are never used, they are only kept so the model file is written back unchanged
+	alignas(cacheLineSize) std::array<float, neuronCount> biases;
+	alignas(cacheLineSize) std::array<float, neuronCount> errorsSums;
+	alignas(cacheLineSize) std::array<float, neuronCount> inputs;
+	alignas(cacheLineSize) std::array<float, neuronCount> outputs;
+	alignas(cacheLineSize) std::array<float, neuronCount> errors;
+
+	std::array<Activation, layerCount> activations;
+	float learningRate = 0.1f;
+	Loss loss = Loss::MeanSquaredError;
+
+	template <int... layers>
+	void propagateForward(std::integer_sequence<int, layers...>) {
+		(propagateLayer<layers + 1>(), ...);
+	}
+
+	// layers are propagated from the output one back to the first hidden one
+	template <int... layers>
+	void propagateError(const Outputs& targets, std::integer_sequence<int, layers...>) {
+		(propagateLayerError<layerCount - 1 - layers>(targets), ...);
+	}
+
+	template <int layer>
+	void propagateLayer() {
+		constexpr unsigned int previousSize = layerSizes[layer - 1];
+		constexpr unsigned int size = layerSizes[layer];
+		const float* previousOutputs = &outputs[neuronOffsets[layer - 1]];
+		const float* layerWeights = &weights[weightOffsets[layer - 1]];
+		float* layerInputs = &inputs[neuronOffsets[layer]];
+
+		for (unsigned int j = 0; j < size; j++) {
+			layerInputs[j] = biases[neuronOffsets[layer] + j];
+		}
+		for (unsigned int i = 0; i < previousSize; i++) {
+			const float previousOutput = previousOutputs[i];
+			for (unsigned int j = 0; j < size; j++) {
+				layerInputs[j] += layerWeights[i * size + j] * previousOutput;
+			}
+		}
+		float* layerOutputs = &outputs[neuronOffsets[layer]];
+		withActivation(activations[layer], [&]<Activation activation>() {
+			activate<activation, size>(layerInputs, layerOutputs);
+		});
+	}
+
+	template <int layer>
+	void propagateLayerError(const Outputs& targets) {
+		constexpr unsigned int previousSize = layerSizes[layer - 1];
+		constexpr unsigned int size = layerSizes[layer];
+		const float* previousOutputs = &outputs[neuronOffsets[layer - 1]];
+		float* layerErrors = &errors[neuronOffsets[layer]];
+
+		const float* layerOutputs = &outputs[neuronOffsets[layer]];
+		auto applyDerivative = [&]<Activation activation>() {
+			activateDerivative<activation, size>(layerOutputs, layerErrors);
+		};
+		if constexpr (layer == layerCount - 1) {
+			computeOutputErrors(layerOutputs, targets.data(), layerErrors, size);
+			if (loss != Loss::CrossEntropy) {
+				withActivation(activations[layer], applyDerivative);
+			}
+		}
+		else {
+			constexpr unsigned int nextSize = layerSizes[layer + 1];
+			const float* nextErrors = &errors[neuronOffsets[layer + 1]];
+			const float* layerWeights = &weights[weightOffsets[layer]];
+			for (unsigned int i = 0; i < size; i++) {
+				layerErrors[i] = dot<nextSize>(layerWeights + i * nextSize, nextErrors);
+			}
+			withActivation(activations[layer], applyDerivative);
+		}
+
+		// sum errors for bias and weights
+		float* layerErrorsSums = &errorsSums[neuronOffsets[layer]];
+		for (unsigned int j = 0; j < size; j++) {
+			layerErrorsSums[j] += layerErrors[j];
+		}
+		float* layerWeightErrorsSums = &weightErrorsSums[weightOffsets[layer - 1]];
+		for (unsigned int i = 0; i < previousSize; i++) {
+			const float previousOutput = previousOutputs[i];
+			for (unsigned int j = 0; j < size; j++) {
+				layerWeightErrorsSums[i * size + j] += previousOutput * layerErrors[j];
+			}
+		}
+	}
+
+	// calls function.template operator()<activation>(), so the loops of a layer are compiled for the activation it uses
+	template <typename Function>
+	static void withActivation(Activation activation, const Function& function) {
+		switch (activation) {
+		case Activation::Sigmoid:
+			function.template operator()<Activation::Sigmoid>();
+			break;
+		case Activation::ReLU:
+			function.template operator()<Activation::ReLU>();
+			break;
+		case Activation::LeakyReLU:
+			function.template operator()<Activation::LeakyReLU>();
+			break;
+		case Activation::Tanh:
+			function.template operator()<Activation::Tanh>();
+			break;
+		case Activation::Softmax:
+			function.template operator()<Activation::Softmax>();
+			break;
+		}
+	}
+
+	// sum of a[i] * b[i], kept in independent partial sums, so the compiler vectorizes it without reordering additions
+	template <unsigned int size>
+	static float dot(const float* a, const float* b) {
+		constexpr unsigned int lanes = 8;
+		constexpr unsigned int vectorSize = size / lanes * lanes;
+		float partialSums[lanes] = {};
+		for (unsigned int i = 0; i < vectorSize; i += lanes) {
+			for (unsigned int lane = 0; lane < lanes; lane++) {
+				partialSums[lane] += a[i + lane] * b[i + lane];
+			}
+		}
+		float sum = 0.0f;
+		for (unsigned int lane = 0; lane < lanes; lane++) {
+			sum += partialSums[lane];
+		}
+		for (unsigned int i = vectorSize; i < size; i++) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	static float sigmoid(float x) {
+		return 1.0f / (1.0f + kernels::expApproximation(-x));
+	}
+
+	// outputs = activation(inputs), the same functions as applyActivation
+	template <Activation activation, unsigned int size>
+	static void activate(const float* inputs, float* outputs) {
+		if constexpr (activation == Activation::Sigmoid) {
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] = sigmoid(inputs[i]);
+			}
+		}
+		else if constexpr (activation == Activation::ReLU) {
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] = std::max(inputs[i], 0.0f);
+			}
+		}
+		else if constexpr (activation == Activation::LeakyReLU) {
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] = (inputs[i] > 0.0f) ? inputs[i] : inputs[i] * leakyReluSlope;
+			}
+		}
+		else if constexpr (activation == Activation::Tanh) {
+			// tanh(x) = 2 * sigmoid(2x) - 1
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] = 2.0f * sigmoid(2.0f * inputs[i]) - 1.0f;
+			}
+		}
+		else {
+			// shifting by the maximum keeps exp from overflowing
+			float maxInput = inputs[0];
+			for (unsigned int i = 1; i < size; i++) {
+				maxInput = std::max(maxInput, inputs[i]);
+			}
+			float sum = 0.0f;
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] = kernels::expApproximation(inputs[i] - maxInput);
+				sum += outputs[i];
+			}
+			const float scale = 1.0f / sum;
+			for (unsigned int i = 0; i < size; i++) {
+				outputs[i] *= scale;
+			}
+		}
+	}
+
+	// errors *= derivative of the activation, the same functions as applyActivationDerivative
+	template <Activation activation, unsigned int size>
+	static void activateDerivative(const float* outputs, float* errors) {
+		if constexpr (activation == Activation::Sigmoid) {
+			for (unsigned int i = 0; i < size; i++) {
+				errors[i] *= outputs[i] * (1.0f - outputs[i]);
+			}
+		}
+		else if constexpr (activation == Activation::ReLU) {
+			for (unsigned int i = 0; i < size; i++) {
+				errors[i] = (outputs[i] > 0.0f) ? errors[i] : 0.0f;
+			}
+		}
+		else if constexpr (activation == Activation::LeakyReLU) {
+			for (unsigned int i = 0; i < size; i++) {
+				errors[i] *= (outputs[i] > 0.0f) ? 1.0f : leakyReluSlope;
+			}
+		}
+		else if constexpr (activation == Activation::Tanh) {
+			for (unsigned int i = 0; i < size; i++) {
+				errors[i] *= 1.0f - outputs[i] * outputs[i];
+			}
+		}
+		else {
+			// full Jacobian of softmax applied to the errors: y_i * (e_i - sum_j e_j * y_j)
+			const float weightedSum = dot<size>(errors, outputs);
+			for (unsigned int i = 0; i < size; i++) {
+				errors[i] = outputs[i] * (errors[i] - weightedSum);
+			}
+		}
+	}
+};
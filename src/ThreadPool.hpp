@@ -2,68 +2,247 @@
 
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
 #include <iostream>
 #include <functional>
-#include <queue>
 #include <condition_variable>
-#include <cstring>
+#include <cstdint>
+
+#include "Random.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+// hint for the core that the thread is spinning, so it does not starve its hyper-thread sibling
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	_mm_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#else
+	std::this_thread::yield();
+#endif
+}
 
 struct Job {
 	std::function<void(int, int)> job;
-	unsigned int repeat;
-	unsigned int repeatsLeft;
+	// added to the repeat index before job is called
+	int offset;
+	// repeats not finished yet
+	std::atomic<unsigned int> repeatsLeft;
+	// tasks are not split below this many repeats
+	unsigned int grainSize;
+	// detached jobs are deleted by the worker finishing the last repeat, others are owned and waited for by the submitter
+	bool detached;
+
+	Job(const std::function<void(int, int)>& job, int offset, unsigned int repeat, unsigned int grainSize, bool detached)
+		: job(job), offset(offset), repeatsLeft(repeat), grainSize(grainSize), detached(detached) {}
 };
 
+// repeats [begin, end) of a job
+struct Task {
+	Job* job;
+	unsigned int begin;
+	unsigned int end;
+};
+
+// Chase-Lev work-stealing deque (Chase and Lev, "Dynamic Circular Work-Stealing Deque", with the memory orders of Le et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models"), only the owner pushes and pops at the bottom, any thread
+// steals from the top by moving it with a compare-and-swap, so neither side ever takes a lock
+class TaskDeque {
+public:
+	TaskDeque() {
+		buffers.push_back(std::make_unique<Buffer>(initialCapacity));
+		buffer.store(buffers.back().get(), std::memory_order_relaxed);
+	}
+
+	// owner only
+	void push(const Task& task) {
+		const std::int64_t b = bottom.load(std::memory_order_relaxed);
+		const std::int64_t t = top.load(std::memory_order_acquire);
+		Buffer* current = buffer.load(std::memory_order_relaxed);
+		if (b - t >= current->capacity) {
+			current = grow(current, t, b);
+		}
+		current->put(b, task);
+		bottom.store(b + 1, std::memory_order_release);
+	}
+
+	// owner only, takes the task pushed last
+	bool pop(Task& task) {
+		const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		Buffer* current = buffer.load(std::memory_order_relaxed);
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+		task = current->get(b);
+		if (t == b) {
+			// the last task, thieves race for it through top
+			const bool taken = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return taken;
+		}
+		return true;
+	}
+
+	// any thread, takes the oldest task, fails when the deque is empty or another thread took the task first
+	bool steal(Task& task) {
+		std::int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const std::int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b) {
+			return false;
+		}
+		task = buffer.load(std::memory_order_acquire)->get(t);
+		return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr std::int64_t initialCapacity = 64;
+
+	// a thief may read a slot while the owner overwrites it, it then fails its compare-and-swap and drops what it read,
+	// so the fields only have to be atomic on their own
+	struct Slot {
+		std::atomic<Job*> job;
+		std::atomic<unsigned int> begin;
+		std::atomic<unsigned int> end;
+	};
+
+	// circular array indexed by top and bottom modulo its capacity, a power of two
+	struct Buffer {
+		const std::int64_t capacity;
+		std::unique_ptr<Slot[]> slots;
+
+		Buffer(std::int64_t capacity) : capacity(capacity), slots(std::make_unique<Slot[]>(capacity)) {}
+
+		void put(std::int64_t index, const Task& task) {
+			Slot& slot = slots[index & (capacity - 1)];
+			slot.job.store(task.job, std::memory_order_relaxed);
+			slot.begin.store(task.begin, std::memory_order_relaxed);
+			slot.end.store(task.end, std::memory_order_relaxed);
+		}
+
+		Task get(std::int64_t index) const {
+			const Slot& slot = slots[index & (capacity - 1)];
+			return { slot.job.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed) };
+		}
+	};
+
+	// owner only, thieves may still read the old buffer, so it is kept until the deque is destroyed
+	Buffer* grow(Buffer* current, std::int64_t t, std::int64_t b) {
+		buffers.push_back(std::make_unique<Buffer>(current->capacity * 2));
+		Buffer* grown = buffers.back().get();
+		for (std::int64_t i = t; i < b; i++) {
+			grown->put(i, current->get(i));
+		}
+		buffer.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+	// on their own cache lines, thieves only write top and the owner mostly writes bottom
+	alignas(64) std::atomic<std::int64_t> top = 0;
+	alignas(64) std::atomic<std::int64_t> bottom = 0;
+	std::atomic<Buffer*> buffer;
+	std::vector<std::unique_ptr<Buffer>> buffers;
+};
+
+// work-stealing pool, every worker has its own lock-free deque of tasks, so workers only contend when one of them runs out of work
+// a worker takes tasks from the bottom of its deque and splits large ones in halves, leaving the upper half at the bottom,
+// idle workers steal from the top of the deques of random other workers, which holds the largest remaining ranges
+// tasks submitted by threads outside of the pool go through a shared queue that idle workers drain before they steal
 class ThreadPool {
 public:
-	ThreadPool(int threadCount) {
+	ThreadPool(int threadCount) : threadCount(std::max(threadCount, 0)), spinCount(getSpinCount(threadCount)) {
 		if (threadCount > 0) {
-			this->occupied = new bool[threadCount];
-			memset(this->occupied, false, threadCount * sizeof(bool));
+			this->workers = std::make_unique<Worker[]>(threadCount);
+			for (int i = 0; i < threadCount; i++) {
+				this->workers[i].random = Random(0, i);
+			}
 			this->threads.reserve(threadCount);
 			for (int i = 0; i < threadCount; i++) {
 				this->threads.push_back(std::thread(&ThreadPool::threadEntry, this, i));
 			}
 		}
-		else {
-			this->occupied = nullptr;
-		}
 	}
 
+	// runs job(index, threadId) for every index in [0, repeat), the repeats are split into one task per worker
 	void addJob(const std::function<void(int, int)>& job, unsigned int repeat) {
-		std::unique_lock<std::mutex> lock(mutex);
-		this->jobs.push(Job(job, repeat, repeat));
-		if (repeat >= threads.size()) {
-			cv.notify_all();
+		if (repeat == 0) {
+			return;
 		}
-		else {
-			for (int i = 0; i < repeat; i++) {
-				cv.notify_one();
+		Job* newJob = new Job(job, 0, repeat, getGrainSize(repeat), true);
+		activeJobs.fetch_add(1);
+
+		const unsigned int parts = std::min(repeat, threadCount);
+		// counted before they are pushed, so a worker taking one right away never sees the count below zero
+		queuedTasks.fetch_add(parts);
+		{
+			std::unique_lock<std::mutex> lock(submittedMutex);
+			for (unsigned int i = 0; i < parts; i++) {
+				submitted.push_back({ newJob, repeat * i / parts, repeat * (i + 1) / parts });
 			}
+			submittedCount.fetch_add(parts);
 		}
+		notifyWorkers(parts);
 	}
 
-	bool isOccupied() {
-		if (occupied != nullptr) {
-			for (int i = 0; i < threads.size(); i++) {
-				if (occupied[i]) {
-					return true;
-				}
+	// runs function(index, threadId) for every index in [begin, end) and returns once all of them are done
+	// the whole range is submitted as a single task that workers split between themselves down to grainSize indices,
+	// 0 picks the grain size from the range size and thread count, without threads the range runs on the calling thread
+	// waits only for this range, so it can be used while other jobs are running
+	void parallelFor(int begin, int end, unsigned int grainSize, const std::function<void(int, int)>& function) {
+		if (end <= begin) {
+			return;
+		}
+		const unsigned int count = end - begin;
+		if (threadCount == 0) {
+			for (int i = begin; i < end; i++) {
+				function(i, 0);
 			}
+			return;
 		}
-		return !(jobs.size() <= 0);
+
+		Job job(function, begin, count, (grainSize > 0) ? grainSize : getGrainSize(count), false);
+		queuedTasks.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> lock(submittedMutex);
+			submitted.push_back({ &job, 0, count });
+			submittedCount.fetch_add(1);
+		}
+		// every split wakes another worker, so only as many workers as there are tasks are woken
+		notifyWorkers(1);
+
+		waitUntil(completions, [&job]() { return job.repeatsLeft.load() == 0; });
+	}
+
+	unsigned int getThreadCount() {
+		return threadCount;
+	}
+
+	// true while jobs added with addJob are not finished
+	bool isOccupied() {
+		return activeJobs.load() > 0;
 	}
 
+	// blocks until all jobs added with addJob are finished
 	void wait() {
-		std::unique_lock lock(waitMutex);
-		while (isOccupied()) {
-			workDone.wait(lock);
-		}
+		waitUntil(activeJobs, [this]() { return !isOccupied(); });
 	}
 
 	~ThreadPool() {
-		terminate = true;
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			terminate = true;
+		}
 		cv.notify_all();
 
 		if (threads.size() > 0) {
@@ -72,65 +251,193 @@ public:
 				thread.join();
 			}
 		}
-		delete[] occupied;
 	}
 
 private:
+	// padded to a cache line, so workers do not share lines
+	struct alignas(64) Worker {
+		TaskDeque tasks;
+		// picks the victims of stealTask, so idle workers spread over the others instead of all trying the same ones first
+		Random random;
+	};
+
+	static constexpr unsigned int tasksPerWorker = 8;
+
+	// set before the workers start, unlike the size of threads
+	const unsigned int threadCount;
 	std::vector<std::thread> threads;
-	std::mutex mutex;
-	std::mutex waitMutex;
-	std::queue<Job> jobs;
+	std::unique_ptr<Worker[]> workers;
+
+	// tasks submitted from outside of the pool, which cannot push to the deques of the workers
+	std::mutex submittedMutex;
+	std::deque<Task> submitted;
+	std::atomic<unsigned int> submittedCount = 0;
+
+	// tasks in all deques and in submitted, workers sleep when it is zero
+	std::atomic<unsigned int> queuedTasks = 0;
+	std::atomic<unsigned int> sleepingWorkers = 0;
+	std::mutex sleepMutex;
 	std::condition_variable cv;
-	std::condition_variable workDone;
-	bool* occupied;
 	bool terminate = false;
 
+	// jobs added with addJob and not finished yet, wait parks on it
+	std::atomic<unsigned int> activeJobs = 0;
+	// increased whenever a job owned by its submitter finishes, parallelFor parks on it instead of on the job,
+	// so the worker finishing a job never touches it after the submitter may have returned
+	std::atomic<unsigned int> completions = 0;
+
+	// iterations waiting threads and idle workers spin before they park
+	const unsigned int spinCount;
+
+	// spinning only helps when every thread has its own core, otherwise it takes time from the threads doing the work
+	static unsigned int getSpinCount(int threadCount) {
+		return (threadCount + 1 <= (int)std::thread::hardware_concurrency()) ? 4096 : 0;
+	}
+
+	// returns once condition is true, spins for a while first and then parks on counter,
+	// which has to change every time the condition may have become true
+	template <typename Condition>
+	void waitUntil(std::atomic<unsigned int>& counter, const Condition& condition) {
+		for (unsigned int i = 0; i < spinCount; i++) {
+			if (condition()) {
+				return;
+			}
+			cpuRelax();
+		}
+		while (true) {
+			const unsigned int value = counter.load();
+			if (condition()) {
+				return;
+			}
+			counter.wait(value);
+		}
+	}
+
+	// wakes workers for count new tasks, has to be called after they are pushed
+	// a worker going to sleep increases sleepingWorkers before checking queuedTasks, so either it sees the new tasks
+	// or the sleeping worker is seen here, the lock makes sure it is already waiting when notified
+	void notifyWorkers(unsigned int count) {
+		if (sleepingWorkers.load() == 0) {
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+		}
+		if (count >= threadCount) {
+			cv.notify_all();
+		}
+		else {
+			for (unsigned int i = 0; i < count; i++) {
+				cv.notify_one();
+			}
+		}
+	}
+
+	// a few tasks per worker are enough to rebalance, smaller ones only add scheduling overhead
+	unsigned int getGrainSize(unsigned int repeat) {
+		return std::max(repeat / (threadCount * tasksPerWorker), 1u);
+	}
+
+	bool popTask(unsigned int threadId, Task& task) {
+		if (!workers[threadId].tasks.pop(task)) {
+			return false;
+		}
+		queuedTasks.fetch_sub(1);
+		return true;
+	}
+
+	bool takeSubmittedTask(Task& task) {
+		if (submittedCount.load() == 0) {
+			return false;
+		}
+		std::unique_lock<std::mutex> lock(submittedMutex);
+		if (submitted.empty()) {
+			return false;
+		}
+		task = submitted.front();
+		submitted.pop_front();
+		submittedCount.fetch_sub(1);
+		queuedTasks.fetch_sub(1);
+		return true;
+	}
+
+	// tries every other worker once, starting from a random one
+	bool stealTask(unsigned int threadId, Task& task) {
+		if (threadCount < 2) {
+			return false;
+		}
+		const unsigned int first = workers[threadId].random.nextInt(threadCount - 1);
+		for (unsigned int i = 0; i < threadCount - 1; i++) {
+			const unsigned int victim = (threadId + 1 + (first + i) % (threadCount - 1)) % threadCount;
+			if (workers[victim].tasks.steal(task)) {
+				queuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// runs the task, the upper halves of the range are pushed back for other workers while it is larger than the grain size
+	void runTask(unsigned int threadId, Task task) {
+		while (task.end - task.begin > task.job->grainSize && threadCount > 1) {
+			const unsigned int middle = task.begin + (task.end - task.begin) / 2;
+			queuedTasks.fetch_add(1);
+			workers[threadId].tasks.push({ task.job, middle, task.end });
+			notifyWorkers(1);
+			task.end = middle;
+		}
+
+		Job* job = task.job;
+		for (unsigned int i = task.begin; i < task.end; i++) {
+			job->job(job->offset + i, threadId);
+		}
+
+		// an owned job may be destroyed by its submitter as soon as the last repeat is counted, so it is not touched after that
+		const bool detached = job->detached;
+		const unsigned int count = task.end - task.begin;
+		if (job->repeatsLeft.fetch_sub(count) == count) {
+			if (detached) {
+				delete job;
+				if (activeJobs.fetch_sub(1) == 1) {
+					activeJobs.notify_all();
+				}
+			}
+			else {
+				completions.fetch_add(1);
+				completions.notify_all();
+			}
+		}
+	}
+
 	void threadEntry(int threadId) {
 		{
-			std::unique_lock<std::mutex> lock(mutex);
+			std::unique_lock<std::mutex> lock(sleepMutex);
 			std::cout << "Thread " << threadId << " started" << std::endl;
 		}
 
-		Job job;
-		unsigned int repeat = 0;
+		Task task;
 		while (true) {
-			if (terminate) {
-				return;
+			if (popTask(threadId, task) || takeSubmittedTask(task) || stealTask(threadId, task)) {
+				runTask(threadId, task);
+				continue;
 			}
 
-			{
-				std::unique_lock<std::mutex> lock(mutex);
-				while (jobs.size() <= 0) {
-					cv.wait(lock);
-					if (terminate) {
-						return;
-					}
-				}
-				occupied[threadId] = true;
-				Job* front = &jobs.front();
-				job = *front;
-				if (job.repeatsLeft >= 1) {
-					repeat = job.repeat;
-					repeat /= threads.size();
-					repeat = std::max(std::min(job.repeatsLeft, repeat), 1u);
-
-					front->repeatsLeft -= repeat;
-				}
-				if (front->repeatsLeft <= 0) {
-					jobs.pop();
-				}
-				//std::cout << "Thread " << threadId << " got a job of " << repeat << " repeats" << std::endl;
+			// work submitted right after the previous one is picked up without waking the worker up
+			bool queued = false;
+			for (unsigned int i = 0; i < spinCount && !queued; i++) {
+				queued = queuedTasks.load() > 0;
+				cpuRelax();
 			}
-			while (repeat > 0) {
-				//std::cout << "Thread " << threadId <<  " " << job.repeatsLeft - repeat << std::endl;
-				job.job(job.repeatsLeft - repeat, threadId);
-				repeat--;
+			if (queued) {
+				continue;
 			}
-			repeat = 0;
-			occupied[threadId] = false;
-			{
-				std::unique_lock<std::mutex> lock(waitMutex);
-				workDone.notify_all();
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepingWorkers.fetch_add(1);
+			cv.wait(lock, [this]() { return terminate || queuedTasks.load() > 0; });
+			sleepingWorkers.fetch_sub(1);
+			if (terminate) {
+				return;
 			}
 		}
 	}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "DataLoader.hpp"
+
+// batches have to come out in order of their sample indices for any number of loader threads and buffers
+void testDataLoader() {
+	constexpr unsigned int batchSize = 5;
+	for (unsigned int threadCount : { 1u, 3u }) {
+		for (unsigned int bufferCount : { 2u, 4u }) {
+			DataLoader loader(3, 1, batchSize, [](TrainingData& sample, std::uint64_t sampleIndex) {
+				for (unsigned int i = 0; i < 3; i++) {
+					sample.inputs(i) = (float)(sampleIndex * 3 + i);
+				}
+				sample.outputs(0) = (float)sampleIndex;
+				// uneven preparation times, so loader threads finish their batches out of order
+				if (sampleIndex % 7 == 0) {
+					std::this_thread::yield();
+				}
+			}, bufferCount, threadCount);
+
+			for (std::uint64_t batch = 0; batch < 500; batch++) {
+				const std::vector<TrainingData>& samples = loader.next();
+				if (samples.size() != batchSize) {
+					throw std::runtime_error("DataLoader batch size test failed");
+				}
+				for (unsigned int i = 0; i < batchSize; i++) {
+					const std::uint64_t sampleIndex = batch * batchSize + i;
+					if (samples[i].outputs(0) != (float)sampleIndex || samples[i].inputs(2) != (float)(sampleIndex * 3 + 2)) {
+						throw std::runtime_error("DataLoader order test failed");
+					}
+				}
+			}
+		}
+	}
+
+	// an exception thrown while preparing a batch is rethrown by next
+	DataLoader failing(1, 1, 4, [](TrainingData&, std::uint64_t sampleIndex) {
+		if (sampleIndex == 9) {
+			throw std::runtime_error("prepare failed");
+		}
+	});
+	bool thrown = false;
+	try {
+		for (int i = 0; i < 4; i++) {
+			failing.next();
+		}
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	if (!thrown) {
+		throw std::runtime_error("DataLoader error test failed");
+	}
+	std::cout << "DataLoader test passed" << std::endl;
+}
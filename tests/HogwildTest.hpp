@@ -0,0 +1,70 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+#include "Network.hpp"
+
+constexpr unsigned int hogwildInputSize = 13;
+constexpr unsigned int hogwildOutputSize = 4;
+
+std::vector<TrainingData> getHogwildSamples(unsigned int count) {
+	std::vector<TrainingData> samples(count, TrainingData(hogwildInputSize, hogwildOutputSize));
+	for (unsigned int k = 0; k < count; k++) {
+		for (unsigned int i = 0; i < hogwildInputSize; i++) {
+			samples[k].inputs(i) = (float)((int)((k * hogwildInputSize + i) * 29 % 61) - 30) / 30.0f;
+		}
+		for (unsigned int i = 0; i < hogwildOutputSize; i++) {
+			samples[k].outputs(i) = (i == k % hogwildOutputSize) ? 1.0f : 0.0f;
+		}
+	}
+	return samples;
+}
+
+float getHogwildLoss(Network& network, const std::vector<TrainingData>& samples) {
+	float loss = 0.0f;
+	for (const TrainingData& sample : samples) {
+		network.setInputs(sample, 0);
+		network.propagateForward(0);
+		loss += network.getError(sample, 0);
+	}
+	return loss;
+}
+
+// a single Hogwild thread updates after every mini-batch of a long stream, like a synchronous batch per mini-batch,
+// mini-batches larger than maxBatchSize grow the layers, several threads train the whole stream in a single call
+void testHogwild() {
+	const unsigned int miniBatchSize = 8;
+	const std::vector<TrainingData> samples = getHogwildSamples(5 * miniBatchSize);
+
+	seedThreadRandom(3);
+	Network hogwild({ hogwildInputSize, 16, hogwildOutputSize }, 4, 1);
+	seedThreadRandom(3);
+	Network synchronous({ hogwildInputSize, 16, hogwildOutputSize }, miniBatchSize, 1);
+	hogwild.setTrainingMode(TrainingMode::Hogwild);
+	hogwild.setHogwildMiniBatchSize(miniBatchSize);
+
+	hogwild.trainBatch(samples);
+	for (unsigned int first = 0; first < samples.size(); first += miniBatchSize) {
+		synchronous.trainBatch(std::vector<TrainingData>(samples.begin() + first, samples.begin() + first + miniBatchSize));
+	}
+	if (hogwild.getOutputLayer()->getSampleCapacity() < miniBatchSize ||
+		std::fabs(getHogwildLoss(hogwild, samples) - getHogwildLoss(synchronous, samples)) > 1e-5f) {
+		throw std::runtime_error("Hogwild single thread test failed");
+	}
+
+	seedThreadRandom(3);
+	Network parallel({ hogwildInputSize, 16, hogwildOutputSize }, 4, 3);
+	parallel.setTrainingMode(TrainingMode::Hogwild);
+	parallel.setHogwildMiniBatchSize(miniBatchSize);
+	const float initialLoss = getHogwildLoss(parallel, samples);
+	for (int epoch = 0; epoch < 20; epoch++) {
+		parallel.trainBatch(samples);
+	}
+	if (!(getHogwildLoss(parallel, samples) < initialLoss) || parallel.getOutputLayer()->getSampleCapacity() < 3 * miniBatchSize) {
+		throw std::runtime_error("Hogwild test failed");
+	}
+	std::cout << "Hogwild test passed" << std::endl;
+}
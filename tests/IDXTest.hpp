@@ -0,0 +1,158 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "IDX_Importer.hpp"
+
+// writes an IDX file with the given sizes whose elements are the bytes of values in MSB first order
+template <typename T>
+void writeIDX(const char* path, const std::vector<unsigned int>& sizes, const std::vector<T>& values) {
+	std::ofstream file(path, std::ios::binary);
+	const unsigned char magic[4] = { 0, 0, IDX::getDataType<T>(), (unsigned char)sizes.size() };
+	file.write((const char*)magic, 4);
+	for (unsigned int size : sizes) {
+		const unsigned char bytes[4] = { (unsigned char)(size >> 24), (unsigned char)(size >> 16), (unsigned char)(size >> 8), (unsigned char)size };
+		file.write((const char*)bytes, 4);
+	}
+	for (const T& value : values) {
+		unsigned char bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		if constexpr (std::endian::native == std::endian::little) {
+			std::reverse(bytes, bytes + sizeof(T));
+		}
+		file.write((const char*)bytes, sizeof(T));
+	}
+}
+
+// values stored in the test files, the same for every element type
+template <typename T>
+std::vector<T> getIDXValues(std::uint64_t count) {
+	std::vector<T> values;
+	for (std::uint64_t i = 0; i < count; i++) {
+		values.push_back((T)((int)(i * 37 % 101) - 50));
+	}
+	return values;
+}
+
+// a mapped file gives back the header and payload of the file, broken files are rejected instead of read out of bounds
+void testIDXMapping() {
+	const std::vector<std::uint8_t> values = getIDXValues<std::uint8_t>(3 * 4 * 5);
+	writeIDX<std::uint8_t>("test_mapped.idx", { 3, 4, 5 }, values);
+	IDX::IDX_MappedData mapped = IDX::map("test_mapped.idx");
+	if (!mapped.isValid() || mapped.getHeader().dimensions != 3 || mapped.getHeader().sizes[0] != 3 || mapped.getHeader().sizes[2] != 5 ||
+		mapped.getElementCount() != values.size() || mapped.getData().size() != values.size()) {
+		throw std::runtime_error("IDX mapped header test failed");
+	}
+	if (!std::equal(values.begin(), values.end(), mapped.getData().begin())) {
+		throw std::runtime_error("IDX mapped data test failed");
+	}
+
+	// moving keeps the mapping alive in the new object only
+	IDX::IDX_MappedData moved(std::move(mapped));
+	if (!moved.isValid() || mapped.isValid() || !std::equal(values.begin(), values.end(), moved.getData().begin())) {
+		throw std::runtime_error("IDX mapped move test failed");
+	}
+
+	std::ofstream("test_truncated.idx", std::ios::binary).write("\0\0\x08\x01\0\0\0\x10" "abc", 11);
+	std::ofstream("test_bad_magic.idx", std::ios::binary).write("\1\0\x08\x01\0\0\0\x01" "a", 9);
+	std::ofstream("test_bad_type.idx", std::ios::binary).write("\0\0\x07\x01\0\0\0\x01" "a", 9);
+	for (const char* path : { "test_truncated.idx", "test_bad_magic.idx", "test_bad_type.idx", "test_missing.idx" }) {
+		if (IDX::map(path).isValid()) {
+			throw std::runtime_error("IDX invalid file test failed");
+		}
+	}
+	std::cout << "IDX mapping test passed" << std::endl;
+}
+
+// import and map give back the values of every element type through a view of their type
+template <typename T>
+void checkIDXFile(const char* path, const std::vector<unsigned int>& sizes) {
+	std::uint64_t count = 1;
+	for (unsigned int size : sizes) {
+		count *= size;
+	}
+	const std::vector<T> values = getIDXValues<T>(count);
+	writeIDX(path, sizes, values);
+
+	IDX::IDX_Data imported = IDX::import(path);
+	IDX::IDX_MappedData mapped = IDX::map(path);
+	if (!mapped.isValid() || mapped.getHeader().dimensions != sizes.size() || mapped.getElementCount() != count) {
+		throw std::runtime_error("IDX header test failed");
+	}
+	const std::span<const T> importedValues = imported.view<T>();
+	const std::span<const T> mappedValues = mapped.view<T>();
+	if (importedValues.size() != count || mappedValues.size() != count || (std::uintptr_t)mappedValues.data() % alignof(T) != 0) {
+		throw std::runtime_error("IDX view size test failed");
+	}
+	for (std::uint64_t i = 0; i < count; i++) {
+		if (importedValues[i] != values[i] || mappedValues[i] != values[i]) {
+			throw std::runtime_error("IDX value test failed");
+		}
+	}
+
+	// the mapping keeps the bytes of the file, the elements are only swapped in the copy the view reads
+	std::vector<unsigned char> fileBytes(count * sizeof(T));
+	std::ifstream file(path, std::ios::binary);
+	file.seekg(4 + 4 * sizes.size());
+	file.read((char*)fileBytes.data(), fileBytes.size());
+	if (!std::equal(fileBytes.begin(), fileBytes.end(), mapped.getData().begin()) ||
+		(sizeof(T) == 1 && mapped.getNativeData().data() != mapped.getData().data())) {
+		throw std::runtime_error("IDX mapped bytes test failed");
+	}
+
+	// a view of another type is rejected
+	bool thrown = false;
+	try {
+		if constexpr (std::is_same_v<T, float>) {
+			mapped.view<std::int32_t>();
+		}
+		else {
+			mapped.view<float>();
+		}
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	if (!thrown) {
+		throw std::runtime_error("IDX view type test failed");
+	}
+}
+
+void testIDX() {
+	testIDXMapping();
+
+	// lengths around the 16 byte blocks of the vector swap, so both the vector and the scalar tail are checked
+	for (unsigned int elementSize : { 2u, 4u, 8u }) {
+		for (unsigned int count : { 0u, 1u, 3u, 8u, 17u, 64u, 67u }) {
+			std::vector<unsigned char> data(count * elementSize);
+			for (unsigned int i = 0; i < data.size(); i++) {
+				data[i] = (unsigned char)(i * 13 + 1);
+			}
+			std::vector<unsigned char> swapped = data;
+			IDX::swapByteOrder(swapped.data(), count, elementSize);
+			for (unsigned int i = 0; i < count; i++) {
+				for (unsigned int j = 0; j < elementSize; j++) {
+					const unsigned char expected = (std::endian::native == std::endian::little) ? data[i * elementSize + elementSize - 1 - j] : data[i * elementSize + j];
+					if (swapped[i * elementSize + j] != expected) {
+						throw std::runtime_error("IDX byte swap test failed");
+					}
+				}
+			}
+		}
+	}
+
+	// an even number of dimensions leaves the payload 4 bytes off the alignment of doubles
+	checkIDXFile<std::uint8_t>("test_ubyte.idx", { 3, 5 });
+	checkIDXFile<std::int8_t>("test_byte.idx", { 9 });
+	checkIDXFile<std::int16_t>("test_short.idx", { 7, 3 });
+	checkIDXFile<std::int32_t>("test_int.idx", { 4, 2, 5 });
+	checkIDXFile<float>("test_float.idx", { 33 });
+	checkIDXFile<double>("test_double.idx", { 6, 5 });
+	checkIDXFile<double>("test_double_3d.idx", { 2, 3, 7 });
+	std::cout << "IDX types test passed" << std::endl;
+}
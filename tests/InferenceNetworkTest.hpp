@@ -0,0 +1,233 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+#include "Network.hpp"
+#include "InferenceNetwork.hpp"
+
+constexpr unsigned int inferenceInputSize = 13;
+constexpr unsigned int inferenceOutputSize = 4;
+
+// count samples of inferenceInputSize values in [-1, 1] stored one after another
+std::vector<float> getInferenceInputs(unsigned int count) {
+	std::vector<float> inputs(count * inferenceInputSize);
+	for (unsigned int i = 0; i < inputs.size(); i++) {
+		inputs[i] = (float)((int)(i * 29 % 61) - 30) / 30.0f;
+	}
+	return inputs;
+}
+
+// outputs of Network::propagateForward for every sample, one sample at a time
+std::vector<float> propagateSamples(Network& network, const std::vector<float>& inputs) {
+	const unsigned int count = inputs.size() / inferenceInputSize;
+	std::vector<float> outputs(count * inferenceOutputSize);
+	TrainingData sample(inferenceInputSize, inferenceOutputSize);
+	for (unsigned int iSample = 0; iSample < count; iSample++) {
+		for (unsigned int i = 0; i < inferenceInputSize; i++) {
+			sample.inputs(i) = inputs[iSample * inferenceInputSize + i];
+		}
+		network.setInputs(sample, 0);
+		network.propagateForward(0);
+		for (unsigned int i = 0; i < inferenceOutputSize; i++) {
+			outputs[iSample * inferenceOutputSize + i] = network.getOutputLayer()->getOutputs()(i, 0);
+		}
+	}
+	return outputs;
+}
+
+float getMaxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+	if (a.size() != b.size()) {
+		throw std::runtime_error("Output sizes do not match");
+	}
+	float difference = 0.0f;
+	for (unsigned int i = 0; i < a.size(); i++) {
+		difference = std::max(difference, std::fabs(a[i] - b[i]));
+	}
+	return difference;
+}
+
+// outputs of predict for every sample
+std::vector<float> predictSamples(const InferenceNetwork& network, const std::vector<float>& inputs) {
+	const unsigned int count = inputs.size() / inferenceInputSize;
+	std::vector<float> outputs(count * inferenceOutputSize);
+	InferenceNetwork::Workspace workspace = network.createWorkspace();
+	for (unsigned int iSample = 0; iSample < count; iSample++) {
+		network.predict(&inputs[iSample * inferenceInputSize], &outputs[iSample * inferenceOutputSize], workspace);
+	}
+	return outputs;
+}
+
+// a frozen network and one loaded from a saved model predict the same as the network they come from
+void testFrozenNetwork() {
+	const std::initializer_list<Activation> activations = { Activation::ReLU, Activation::Tanh, Activation::Softmax };
+	seedThreadRandom(4);
+	Network network({ inferenceInputSize, 37, 16, inferenceOutputSize }, activations, 32, 1);
+	const std::vector<float> inputs = getInferenceInputs(50);
+	const std::vector<float> expected = propagateSamples(network, inputs);
+
+	const InferenceNetwork frozen = network.freeze();
+	if (frozen.getInputSize() != inferenceInputSize || frozen.getOutputSize() != inferenceOutputSize || frozen.getLayerCount() != 4) {
+		throw std::runtime_error("InferenceNetwork size test failed");
+	}
+	if (getMaxDifference(predictSamples(frozen, inputs), expected) > 1e-6f) {
+		throw std::runtime_error("InferenceNetwork freeze test failed");
+	}
+
+	network.save("test_inference.dpn");
+	const InferenceNetwork loaded("test_inference.dpn", activations);
+	if (getMaxDifference(predictSamples(loaded, inputs), expected) > 1e-6f) {
+		throw std::runtime_error("InferenceNetwork load test failed");
+	}
+
+	// the frozen network keeps its parameters while the network trains on
+	std::vector<TrainingData> batch(8, TrainingData(inferenceInputSize, inferenceOutputSize));
+	for (TrainingData& sample : batch) {
+		sample.inputs.setAll(0.5f);
+		sample.outputs.setAll(0.25f);
+	}
+	network.trainBatch(batch);
+	if (getMaxDifference(predictSamples(frozen, inputs), expected) > 1e-6f) {
+		throw std::runtime_error("InferenceNetwork copy test failed");
+	}
+
+	bool thrown = false;
+	try {
+		InferenceNetwork wrongActivations("test_inference.dpn", { Activation::ReLU });
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	try {
+		InferenceNetwork missing("test_missing.dpn");
+		thrown = false;
+	}
+	catch (const std::runtime_error&) {
+	}
+	if (!thrown) {
+		throw std::runtime_error("InferenceNetwork invalid model test failed");
+	}
+	std::cout << "InferenceNetwork test passed" << std::endl;
+}
+
+// threads predicting with the same network at once, each with its own workspace or with the one of its thread, get the same
+// outputs as a single thread
+void testConcurrentPredict() {
+	seedThreadRandom(5);
+	Network network({ inferenceInputSize, 37, 16, inferenceOutputSize }, { Activation::ReLU, Activation::Tanh, Activation::Softmax }, 32, 1);
+	const InferenceNetwork frozen = network.freeze();
+	const std::vector<float> inputs = getInferenceInputs(64);
+	const std::vector<float> expected = predictSamples(frozen, inputs);
+
+	std::atomic<bool> same = true;
+	std::vector<std::thread> threads;
+	for (unsigned int thread = 0; thread < 8; thread++) {
+		threads.push_back(std::thread([&frozen, &inputs, &expected, &same, thread]() {
+			const bool ownWorkspace = thread % 2 == 0;
+			InferenceNetwork::Workspace workspace = frozen.createWorkspace();
+			float outputs[inferenceOutputSize];
+			for (unsigned int round = 0; round < 50; round++) {
+				for (unsigned int iSample = (thread + round) % 64, i = 0; i < 64; i++, iSample = (iSample + 1) % 64) {
+					if (ownWorkspace) {
+						frozen.predict(&inputs[iSample * inferenceInputSize], outputs, workspace);
+					}
+					else {
+						frozen.predict(&inputs[iSample * inferenceInputSize], outputs);
+					}
+					for (unsigned int j = 0; j < inferenceOutputSize; j++) {
+						if (outputs[j] != expected[iSample * inferenceOutputSize + j]) {
+							same.store(false);
+						}
+					}
+				}
+			}
+		}));
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	if (!same.load()) {
+		throw std::runtime_error("InferenceNetwork concurrent predict test failed");
+	}
+	std::cout << "InferenceNetwork concurrent predict test passed" << std::endl;
+}
+
+// predictBatch gives the outputs of predict for batches split into several chunks, with and without a pool, and for a single
+// chunk whose layers are split across the pool
+void testPredictBatch() {
+	seedThreadRandom(6);
+	Network network({ inferenceInputSize, 37, 16, inferenceOutputSize }, { Activation::Sigmoid, Activation::LeakyReLU, Activation::Softmax }, 32, 3);
+	InferenceNetwork frozen = network.freeze();
+	ThreadPool threadPool(3);
+	const float tolerance = 1e-5f;
+
+	const unsigned int chunkSize = frozen.getChunkSize();
+	for (unsigned int count : { 1u, chunkSize - 1, chunkSize, 2 * chunkSize + 3 }) {
+		const std::vector<float> inputs = getInferenceInputs(count);
+		const std::vector<float> expected = predictSamples(frozen, inputs);
+
+		std::vector<float> outputs(count * inferenceOutputSize);
+		frozen.predictBatch(inputs.data(), count, outputs.data());
+		if (getMaxDifference(outputs, expected) > tolerance) {
+			throw std::runtime_error("InferenceNetwork predictBatch test failed");
+		}
+
+		std::fill(outputs.begin(), outputs.end(), 0.0f);
+		frozen.predictBatch(InputBatch(inputs.data(), count), outputs.data(), &threadPool);
+		if (getMaxDifference(outputs, expected) > tolerance) {
+			throw std::runtime_error("InferenceNetwork parallel predictBatch test failed");
+		}
+
+		std::fill(outputs.begin(), outputs.end(), 0.0f);
+		network.predictBatch(inputs.data(), count, outputs.data());
+		if (getMaxDifference(outputs, expected) > tolerance) {
+			throw std::runtime_error("Network predictBatch test failed");
+		}
+	}
+
+	// the network reuses its frozen copy between updates and drops it when the parameters change
+	const std::vector<float> updateInputs = getInferenceInputs(20);
+	std::vector<float> updateOutputs(20 * inferenceOutputSize);
+	for (int update = 0; update < 3; update++) {
+		network.predictBatch(updateInputs.data(), 20, updateOutputs.data());
+		if (getMaxDifference(updateOutputs, propagateSamples(network, updateInputs)) > tolerance) {
+			throw std::runtime_error("Network predictBatch after update test failed");
+		}
+		std::vector<TrainingData> batch(8, TrainingData(inferenceInputSize, inferenceOutputSize));
+		for (TrainingData& sample : batch) {
+			sample.inputs.setAll(0.5f);
+			sample.outputs.setAll(0.25f);
+		}
+		network.trainBatch(batch);
+	}
+	network.save("test_predict_batch.dpn");
+	network.trainBatch(std::vector<TrainingData>(8, TrainingData({ 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f },
+		{ 1.0f, 0.0f, 0.0f, 0.0f })));
+	network.predictBatch(updateInputs.data(), 20, updateOutputs.data());
+	network.load("test_predict_batch.dpn");
+	network.predictBatch(updateInputs.data(), 20, updateOutputs.data());
+	if (getMaxDifference(updateOutputs, propagateSamples(network, updateInputs)) > tolerance) {
+		throw std::runtime_error("Network predictBatch after load test failed");
+	}
+
+	// a single chunk has its layers split instead
+	frozen.setParallelLayerThreshold(0);
+	const std::vector<float> inputs = getInferenceInputs(5);
+	const std::vector<float> expected = predictSamples(frozen, inputs);
+	std::vector<float> outputs(5 * inferenceOutputSize);
+	frozen.predictBatch(inputs.data(), 5, outputs.data(), &threadPool);
+	if (getMaxDifference(outputs, expected) > tolerance) {
+		throw std::runtime_error("InferenceNetwork split layer predictBatch test failed");
+	}
+	std::cout << "InferenceNetwork predictBatch test passed" << std::endl;
+}
+
+void testInferenceNetwork() {
+	testFrozenNetwork();
+	testConcurrentPredict();
+	testPredictBatch();
+}
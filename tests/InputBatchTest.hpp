@@ -0,0 +1,173 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "Matrix.hpp"
+#include "Network.hpp"
+#include "InferenceNetwork.hpp"
+
+// large enough for the byte columns to be converted in several blocks
+constexpr unsigned int byteInputSize = 300;
+constexpr unsigned int byteOutputSize = 5;
+constexpr float byteScale = 1.0f / 255.0f;
+constexpr float byteOffset = -0.5f;
+
+// count samples of byteInputSize bytes stored one after another
+std::vector<std::uint8_t> getByteInputs(unsigned int count) {
+	std::vector<std::uint8_t> inputs(count * byteInputSize);
+	for (unsigned int i = 0; i < inputs.size(); i++) {
+		inputs[i] = (std::uint8_t)(i * 37 % 251);
+	}
+	return inputs;
+}
+
+// the bytes as the first layer reads them
+std::vector<float> normalizeBytes(const std::vector<std::uint8_t>& bytes) {
+	std::vector<float> floats(bytes.size());
+	for (unsigned int i = 0; i < bytes.size(); i++) {
+		floats[i] = byteScale * bytes[i] + byteOffset;
+	}
+	return floats;
+}
+
+bool isClose(float value, float expected) {
+	return std::fabs(value - expected) <= 1e-5f * (1.0f + std::fabs(expected));
+}
+
+// the fused conversion matches the float products, also when the columns end in a partial block
+void testByteColumns() {
+	const unsigned int block = getByteColumnBlock(byteInputSize);
+	const unsigned int outputs = 7;
+	Matrix2D<float> weights({ byteInputSize, outputs });
+	Matrix1D<float> biases({ outputs });
+	for (unsigned int i = 0; i < outputs; i++) {
+		biases(i) = (float)i * 0.25f - 1.0f;
+		for (unsigned int j = 0; j < byteInputSize; j++) {
+			weights(j, i) = (float)((int)((i * byteInputSize + j) * 29 % 61) - 30) / 30.0f;
+		}
+	}
+
+	for (unsigned int count : { 1u, block, 2 * block + 5 }) {
+		const std::vector<std::uint8_t> bytes = getByteInputs(count);
+		const std::vector<float> floats = normalizeBytes(bytes);
+		const ByteColumns byteColumns = InputBatch(bytes.data(), count, byteScale, byteOffset).getByteColumns(byteInputSize);
+		const MatrixView2D<float> floatColumns = InputBatch(floats.data(), count).getColumns(byteInputSize);
+
+		Matrix2D<float> expected({ outputs, count });
+		Matrix2D<float> result({ outputs, count });
+		multiplyAndAdd(weights, floatColumns, biases, expected);
+		multiplyAndAdd(weights, byteColumns, biases, result);
+		for (unsigned int k = 0; k < count; k++) {
+			for (unsigned int i = 0; i < outputs; i++) {
+				if (!isClose(result(i, k), expected(i, k))) {
+					throw std::runtime_error("ByteColumns multiplyAndAdd test failed");
+				}
+			}
+		}
+
+		// accumulates into sums that are not zero
+		Matrix2D<float> expectedSums({ byteInputSize, outputs });
+		Matrix2D<float> sums({ byteInputSize, outputs });
+		expectedSums.setAll(0.5f);
+		sums.setAll(0.5f);
+		addOuterProducts(floatColumns, expected, expectedSums);
+		addOuterProducts(byteColumns, expected, sums);
+		for (unsigned int i = 0; i < outputs; i++) {
+			for (unsigned int j = 0; j < byteInputSize; j++) {
+				if (!isClose(sums(j, i), expectedSums(j, i))) {
+					throw std::runtime_error("ByteColumns addOuterProducts test failed");
+				}
+			}
+		}
+	}
+	std::cout << "ByteColumns test passed" << std::endl;
+}
+
+// outputs of the output layer in columns [0, count)
+std::vector<float> getOutputColumns(Network& network, unsigned int count) {
+	std::vector<float> outputs(count * byteOutputSize);
+	for (unsigned int k = 0; k < count; k++) {
+		for (unsigned int i = 0; i < byteOutputSize; i++) {
+			outputs[k * byteOutputSize + i] = network.getOutputLayer()->getOutputs()(i, k);
+		}
+	}
+	return outputs;
+}
+
+bool areClose(const std::vector<float>& values, const std::vector<float>& expected) {
+	for (unsigned int i = 0; i < values.size(); i++) {
+		if (!isClose(values[i], expected[i])) {
+			return false;
+		}
+	}
+	return values.size() == expected.size();
+}
+
+// training and prediction on bytes and floats bound from the caller's memory match the same samples copied in with setInputs
+void testInputBatch() {
+	const unsigned int count = 2 * getByteColumnBlock(byteInputSize) + 5;
+	const std::vector<std::uint8_t> bytes = getByteInputs(count);
+	const std::vector<float> floats = normalizeBytes(bytes);
+	std::vector<float> targets(count * byteOutputSize);
+	std::vector<TrainingData> samples(count, TrainingData(byteInputSize, byteOutputSize));
+	for (unsigned int k = 0; k < count; k++) {
+		for (unsigned int i = 0; i < byteInputSize; i++) {
+			samples[k].inputs(i) = floats[k * byteInputSize + i];
+		}
+		for (unsigned int i = 0; i < byteOutputSize; i++) {
+			targets[k * byteOutputSize + i] = samples[k].outputs(i) = (i == k % byteOutputSize) ? 1.0f : 0.0f;
+		}
+	}
+	const InputBatch byteBatch(bytes.data(), count, byteScale, byteOffset);
+	const InputBatch floatBatch(floats.data(), count);
+
+	// the same initial parameters, a single chunk holds the whole batch
+	std::vector<std::unique_ptr<Network>> networks;
+	for (int i = 0; i < 3; i++) {
+		seedThreadRandom(11);
+		networks.push_back(std::make_unique<Network>(std::initializer_list<int>{ (int)byteInputSize, 24, (int)byteOutputSize }, 128, 1));
+	}
+	for (int step = 0; step < 2; step++) {
+		networks[0]->trainBatch(samples);
+		networks[1]->trainBatch(floatBatch, targets.data());
+		networks[2]->trainBatch(byteBatch, targets.data());
+	}
+
+	for (unsigned int i = 0; i < byteOutputSize; i++) {
+		const float expected = networks[0]->getOutputLayer()->getBiases()(i);
+		if (!isClose(networks[1]->getOutputLayer()->getBiases()(i), expected) || !isClose(networks[2]->getOutputLayer()->getBiases()(i), expected)) {
+			throw std::runtime_error("InputBatch training test failed");
+		}
+	}
+
+	for (unsigned int k = 0; k < count; k++) {
+		networks[0]->setInputs(samples[k], k);
+	}
+	networks[0]->propagateForward(0, count);
+	const std::vector<float> expected = getOutputColumns(*networks[0], count);
+	networks[1]->propagateForward(floatBatch, 0);
+	networks[2]->propagateForward(byteBatch, 0);
+	if (!areClose(getOutputColumns(*networks[1], count), expected) || !areClose(getOutputColumns(*networks[2], count), expected)) {
+		throw std::runtime_error("InputBatch propagateForward test failed");
+	}
+
+	std::vector<float> floatOutputs(count * byteOutputSize);
+	std::vector<float> byteOutputs(count * byteOutputSize);
+	networks[2]->predictBatch(floatBatch, floatOutputs.data());
+	networks[2]->predictBatch(byteBatch, byteOutputs.data());
+	if (!areClose(floatOutputs, expected) || !areClose(byteOutputs, expected)) {
+		throw std::runtime_error("InputBatch predictBatch test failed");
+	}
+
+	std::cout << "InputBatch test passed" << std::endl;
+}
+
+void testInputBatches() {
+	testByteColumns();
+	testInputBatch();
+}
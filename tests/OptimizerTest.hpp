@@ -0,0 +1,228 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+#include "Optimizer.hpp"
+#include "Network.hpp"
+
+enum class OptimizerType {
+	SGD,
+	Momentum,
+	RMSProp,
+	Adam
+};
+
+std::unique_ptr<Optimizer> createOptimizer(OptimizerType type) {
+	switch (type) {
+	case OptimizerType::Momentum:
+		return std::make_unique<Momentum>();
+	case OptimizerType::RMSProp:
+		return std::make_unique<RMSProp>();
+	case OptimizerType::Adam:
+		return std::make_unique<Adam>();
+	default:
+		return std::make_unique<SGD>();
+	}
+}
+
+// textbook form of every optimizer, one parameter at a time, with the default hyperparameters of the classes
+struct ReferenceOptimizer {
+	OptimizerType type;
+	std::vector<float> first;
+	std::vector<float> second;
+	unsigned int stepCount = 0;
+
+	ReferenceOptimizer(OptimizerType type, unsigned int size) : type(type), first(size, 0.0f), second(size, 0.0f) {}
+
+	void step(std::vector<float>& parameters, const std::vector<float>& gradients, float learningRate) {
+		stepCount++;
+		for (unsigned int i = 0; i < parameters.size(); i++) {
+			const float gradient = gradients[i];
+			switch (type) {
+			case OptimizerType::SGD:
+				parameters[i] += learningRate * gradient;
+				break;
+			case OptimizerType::Momentum:
+				first[i] = 0.9f * first[i] + learningRate * gradient;
+				parameters[i] += first[i];
+				break;
+			case OptimizerType::RMSProp:
+				first[i] = 0.9f * first[i] + 0.1f * gradient * gradient;
+				parameters[i] += learningRate * gradient / (std::sqrt(first[i]) + 1e-8f);
+				break;
+			case OptimizerType::Adam: {
+				first[i] = 0.9f * first[i] + 0.1f * gradient;
+				second[i] = 0.999f * second[i] + 0.001f * gradient * gradient;
+				const float mean = first[i] / (1.0f - std::pow(0.9f, (float)stepCount));
+				const float variance = second[i] / (1.0f - std::pow(0.999f, (float)stepCount));
+				parameters[i] += learningRate * mean / (std::sqrt(variance) + 1e-8f);
+				break;
+			}
+			}
+		}
+	}
+};
+
+// gradients of a step, different in every step so the state carried between steps matters
+std::vector<float> getStepGradients(unsigned int size, unsigned int step) {
+	std::vector<float> gradients(size);
+	for (unsigned int i = 0; i < size; i++) {
+		gradients[i] = (float)((int)((i + 17 * step) * 37 % 101) - 50) / 25.0f;
+	}
+	return gradients;
+}
+
+bool matchParameters(const std::vector<float>& parameters, const std::vector<float>& expected) {
+	for (unsigned int i = 0; i < parameters.size(); i++) {
+		if (std::fabs(parameters[i] - expected[i]) > 1e-5f * (1.0f + std::fabs(expected[i]))) {
+			return false;
+		}
+	}
+	return parameters.size() == expected.size();
+}
+
+// a few steps of every optimizer match the reference, the error sums are zeroed after every step
+void testOptimizerSteps() {
+	const unsigned int size = 203;
+	const float learningRate = 0.01f;
+	const char* names[] = { "SGD", "Momentum", "RMSProp", "Adam" };
+
+	for (int iType = 0; iType < 4; iType++) {
+		const OptimizerType type = (OptimizerType)iType;
+		std::unique_ptr<Optimizer> optimizer = createOptimizer(type);
+		ReferenceOptimizer reference(type, size);
+		std::vector<float> parameters(size);
+		for (unsigned int i = 0; i < size; i++) {
+			parameters[i] = (float)i / size - 0.5f;
+		}
+		std::vector<float> expected = parameters;
+
+		for (unsigned int step = 0; step < 3; step++) {
+			std::vector<float> errorSums = getStepGradients(size, step);
+			reference.step(expected, errorSums, learningRate);
+			optimizer->beginStep();
+			optimizer->update(0, parameters.data(), errorSums.data(), size, 1, size, learningRate);
+			for (float sum : errorSums) {
+				if (sum != 0.0f) {
+					throw std::runtime_error(std::string(names[iType]) + " error sums test failed");
+				}
+			}
+		}
+		if (!matchParameters(parameters, expected)) {
+			throw std::runtime_error(std::string(names[iType]) + " step test failed");
+		}
+	}
+	std::cout << "Optimizer step test passed" << std::endl;
+}
+
+// a buffer of several blocks with gradients in several slots, updated in ranges that do not start on block boundaries,
+// matches the reference on the summed gradients and leaves every slot zeroed
+void testOptimizerBlocks() {
+	const unsigned int size = 2 * 1024 + 37;
+	const unsigned int slotStride = padToCacheLine<float>(size);
+	const unsigned int slotCount = 3;
+	const unsigned int rangeEnd = 1040;
+	const float learningRate = 0.01f;
+
+	Adam optimizer;
+	ReferenceOptimizer reference(OptimizerType::Adam, size);
+	std::vector<float> parameters(size, 0.25f);
+	std::vector<float> expected = parameters;
+	std::vector<float> errorSums(slotStride * slotCount);
+	for (unsigned int step = 0; step < 2; step++) {
+		std::vector<float> gradients(size, 0.0f);
+		for (unsigned int slot = 0; slot < slotCount; slot++) {
+			const std::vector<float> slotGradients = getStepGradients(size, step * slotCount + slot);
+			for (unsigned int i = 0; i < size; i++) {
+				errorSums[slot * slotStride + i] = slotGradients[i];
+				gradients[i] += slotGradients[i];
+			}
+		}
+		reference.step(expected, gradients, learningRate);
+
+		optimizer.beginStep();
+		optimizer.prepare(3, size);
+		optimizer.update(3, parameters.data(), errorSums.data(), slotStride, slotCount, rangeEnd, size - rangeEnd, learningRate);
+		optimizer.update(3, parameters.data(), errorSums.data(), slotStride, slotCount, 0, rangeEnd, learningRate);
+		for (float sum : errorSums) {
+			if (sum != 0.0f) {
+				throw std::runtime_error("Optimizer block error sums test failed");
+			}
+		}
+	}
+	if (!matchParameters(parameters, expected)) {
+		throw std::runtime_error("Optimizer block test failed");
+	}
+	std::cout << "Optimizer block test passed" << std::endl;
+}
+
+// outputs of the first count columns of the output layer after propagating samples
+std::vector<float> propagateOptimizerSamples(Network& network, const std::vector<TrainingData>& samples) {
+	const unsigned int outputSize = network.getOutputLayer()->getNeuronCount();
+	std::vector<float> outputs(samples.size() * outputSize);
+	for (unsigned int k = 0; k < samples.size(); k++) {
+		network.setInputs(samples[k], k);
+	}
+	network.propagateForward(0, samples.size());
+	for (unsigned int k = 0; k < samples.size(); k++) {
+		for (unsigned int i = 0; i < outputSize; i++) {
+			outputs[k * outputSize + i] = network.getOutputLayer()->getOutputs()(i, k);
+		}
+	}
+	return outputs;
+}
+
+// a network with several update blocks and its error sums spread over several slots, updated by several threads, matches
+// the same network with a single slot updated on the calling thread, every slot is zeroed after the update
+void testNetworkUpdateBlocks() {
+	const unsigned int inputSize = 150;
+	const unsigned int outputSize = 10;
+	std::vector<TrainingData> samples(24, TrainingData(inputSize, outputSize));
+	for (unsigned int k = 0; k < samples.size(); k++) {
+		for (unsigned int i = 0; i < inputSize; i++) {
+			samples[k].inputs(i) = (float)((int)((k * inputSize + i) * 29 % 61) - 30) / 30.0f;
+		}
+		for (unsigned int i = 0; i < outputSize; i++) {
+			samples[k].outputs(i) = (i == k % outputSize) ? 1.0f : 0.0f;
+		}
+	}
+
+	seedThreadRandom(9);
+	Network serial({ (int)inputSize, 120, (int)outputSize }, 32, 1);
+	seedThreadRandom(9);
+	Network parallel({ (int)inputSize, 120, (int)outputSize }, 32, 3);
+	serial.setOptimizer(std::make_unique<Momentum>());
+	parallel.setOptimizer(std::make_unique<Momentum>());
+	for (int step = 0; step < 2; step++) {
+		// the samples are spread over every slot of the parallel network
+		for (unsigned int k = 0; k < samples.size(); k++) {
+			const bool endOfBatch = k + 1 == samples.size();
+			serial.train(samples[k], endOfBatch, 0);
+			parallel.train(samples[k], endOfBatch, k % parallel.getSlotCount());
+		}
+	}
+
+	Matrix2D<float>& errorsSums = parallel.getOutputLayer()->getErrorsSums();
+	for (unsigned int slot = 0; slot < parallel.getSlotCount(); slot++) {
+		for (unsigned int i = 0; i < outputSize; i++) {
+			if (errorsSums(i, slot) != 0.0f) {
+				throw std::runtime_error("Network update block error sums test failed");
+			}
+		}
+	}
+	if (parallel.getSlotCount() != 3 || !matchParameters(propagateOptimizerSamples(parallel, samples), propagateOptimizerSamples(serial, samples))) {
+		throw std::runtime_error("Network update block test failed");
+	}
+	std::cout << "Network update block test passed" << std::endl;
+}
+
+void testOptimizers() {
+	testOptimizerSteps();
+	testOptimizerBlocks();
+	testNetworkUpdateBlocks();
+}
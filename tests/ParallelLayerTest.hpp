@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+#include "Network.hpp"
+#include "InferenceNetwork.hpp"
+#include "ThreadPool.hpp"
+
+constexpr unsigned int parallelInputSize = 13;
+constexpr unsigned int parallelSampleCount = 5;
+
+// outputs of the output layer for the first parallelSampleCount columns, set to the same inputs every time
+std::vector<float> propagateColumns(Network& network) {
+	const unsigned int outputSize = network.getOutputLayer()->getNeuronCount();
+	TrainingData sample(parallelInputSize, outputSize);
+	for (unsigned int k = 0; k < parallelSampleCount; k++) {
+		for (unsigned int i = 0; i < parallelInputSize; i++) {
+			sample.inputs(i) = (float)((int)((k * parallelInputSize + i) * 29 % 61) - 30) / 30.0f;
+		}
+		network.setInputs(sample, k);
+	}
+	network.propagateForward(0, parallelSampleCount);
+
+	std::vector<float> outputs(parallelSampleCount * outputSize);
+	for (unsigned int k = 0; k < parallelSampleCount; k++) {
+		for (unsigned int i = 0; i < outputSize; i++) {
+			outputs[k * outputSize + i] = network.getOutputLayer()->getOutputs()(i, k);
+		}
+	}
+	return outputs;
+}
+
+bool matchOutputs(const std::vector<float>& outputs, const std::vector<float>& expected) {
+	for (unsigned int i = 0; i < outputs.size(); i++) {
+		if (std::fabs(outputs[i] - expected[i]) > 1e-6f) {
+			return false;
+		}
+	}
+	return outputs.size() == expected.size();
+}
+
+// network split across the workers at threshold 0 propagates and predicts the same as on a single thread
+void checkParallelLayers(Network& network, ThreadPool& threadPool) {
+	const std::vector<float> expected = propagateColumns(network);
+	network.setParallelLayerThreshold(0);
+	if (!matchOutputs(propagateColumns(network), expected)) {
+		throw std::runtime_error("Parallel layer propagateForward test failed");
+	}
+
+	InferenceNetwork frozen = network.freeze();
+	InferenceNetwork::Workspace workspace = frozen.createWorkspace();
+	std::vector<float> inputs(parallelInputSize);
+	std::vector<float> serial(frozen.getOutputSize());
+	std::vector<float> parallel(frozen.getOutputSize());
+	for (unsigned int i = 0; i < parallelInputSize; i++) {
+		inputs[i] = (float)i / parallelInputSize - 0.5f;
+	}
+	frozen.setParallelLayerThreshold(defaultParallelLayerThreshold);
+	frozen.predict(inputs.data(), serial.data(), workspace);
+	frozen.setParallelLayerThreshold(0);
+	frozen.predict(inputs.data(), parallel.data(), workspace, threadPool);
+	if (!matchOutputs(parallel, serial)) {
+		throw std::runtime_error("Parallel layer predict test failed");
+	}
+}
+
+// layers that are and are not whole cache lines, softmax output layers spanning several ranges
+void testParallelLayers() {
+	ThreadPool threadPool(3);
+
+	seedThreadRandom(5);
+	Network network({ parallelInputSize, 32, 37, 20 }, { Activation::ReLU, Activation::Tanh, Activation::Softmax }, 8, 3);
+	checkParallelLayers(network, threadPool);
+
+	seedThreadRandom(6);
+	Network lineNetwork({ parallelInputSize, 48, 32 }, { Activation::Sigmoid, Activation::Softmax }, 8, 3);
+	checkParallelLayers(lineNetwork, threadPool);
+
+	std::cout << "Parallel layer test passed" << std::endl;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "Random.hpp"
+#include "Sampler.hpp"
+
+// every epoch of the sampler has to visit every index once
+void checkPermutations(Sampler& sampler, unsigned int epochs) {
+	const unsigned int count = sampler.getCount();
+	for (std::uint64_t epoch = 0; epoch < epochs; epoch++) {
+		std::vector<unsigned int> visits(count);
+		for (unsigned int i = 0; i < count; i++) {
+			const unsigned int index = sampler.getIndex(epoch * count + i);
+			if (index >= count) {
+				throw std::runtime_error("Sampler index test failed");
+			}
+			visits[index]++;
+		}
+		for (unsigned int visit : visits) {
+			if (visit != 1) {
+				throw std::runtime_error("Sampler permutation test failed");
+			}
+		}
+	}
+}
+
+void testRandom() {
+	// known-answer vectors of Philox4x32-10 from Random123
+	const philox::Counter counters[3] = {
+		{ 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+		{ 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF },
+		{ 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 }
+	};
+	const philox::Key keys[3] = {
+		{ 0x00000000, 0x00000000 },
+		{ 0xFFFFFFFF, 0xFFFFFFFF },
+		{ 0xA4093822, 0x299F31D0 }
+	};
+	const philox::Counter expected[3] = {
+		{ 0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8 },
+		{ 0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD },
+		{ 0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1 }
+	};
+	for (int i = 0; i < 3; i++) {
+		if (philox::generate(counters[i], keys[i]) != expected[i]) {
+			throw std::runtime_error("Philox known-answer test failed");
+		}
+	}
+
+	// streams are pure functions of the seed and the stream number
+	Random a(7, 3);
+	Random b(7, 3);
+	Random other(7, 4);
+	bool differs = false;
+	for (int i = 0; i < 100; i++) {
+		const Random::result_type value = a();
+		if (value != b()) {
+			throw std::runtime_error("Random stream test failed");
+		}
+		differs = differs || value != other();
+		const std::uint32_t bounded = a.nextInt(10);
+		b.nextInt(10);
+		other.nextInt(10);
+		if (bounded >= 10) {
+			throw std::runtime_error("Random nextInt test failed");
+		}
+	}
+	if (!differs) {
+		throw std::runtime_error("Random stream test failed");
+	}
+	std::cout << "Random test passed" << std::endl;
+
+	constexpr unsigned int count = 1000;
+	std::vector<unsigned char> labels(count);
+	for (unsigned int i = 0; i < count; i++) {
+		labels[i] = (i < 500) ? 0 : ((i < 800) ? 1 : 2);
+	}
+	ShuffledSampler shuffled(count, 3);
+	StratifiedSampler stratified(labels.data(), count, 3);
+	checkPermutations(shuffled, 3);
+	checkPermutations(stratified, 3);
+
+	// the stratified sampler keeps the 5:3:2 class proportions in every batch of 20 to within one sample
+	for (unsigned int batch = 0; batch < count / 20; batch++) {
+		int classCounts[3] = {};
+		for (unsigned int i = 0; i < 20; i++) {
+			classCounts[labels[stratified.getIndex(count + batch * 20 + i)]]++;
+		}
+		if (std::abs(classCounts[0] - 10) > 1 || std::abs(classCounts[1] - 6) > 1 || std::abs(classCounts[2] - 4) > 1) {
+			throw std::runtime_error("StratifiedSampler balance test failed");
+		}
+	}
+
+	// epochs do not depend on the order they are requested in or on the threads requesting them
+	ShuffledSampler reference(count, 11);
+	std::vector<unsigned int> expectedIndices(8 * count);
+	for (std::uint64_t i = 0; i < expectedIndices.size(); i++) {
+		expectedIndices[i] = reference.getIndex(i);
+	}
+	ShuffledSampler backwards(count, 11);
+	for (std::uint64_t i = expectedIndices.size(); i-- > 0;) {
+		if (backwards.getIndex(i) != expectedIndices[i]) {
+			throw std::runtime_error("Sampler order test failed");
+		}
+	}
+	ShuffledSampler shared(count, 11);
+	std::atomic<bool> same = true;
+	std::vector<std::thread> threads;
+	for (unsigned int thread = 0; thread < 4; thread++) {
+		threads.push_back(std::thread([&shared, &expectedIndices, &same, thread]() {
+			for (std::uint64_t i = thread; i < expectedIndices.size(); i += 4) {
+				if (shared.getIndex(i) != expectedIndices[i]) {
+					same.store(false);
+				}
+			}
+		}));
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	if (!same.load()) {
+		throw std::runtime_error("Sampler thread test failed");
+	}
+	std::cout << "Sampler test passed" << std::endl;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+
+#include "Network.hpp"
+#include "StaticNetwork.hpp"
+
+using TestStaticNetwork = StaticNetwork<2, 30, 20, 10, 3>;
+
+// largest difference between the outputs of both networks over a few inputs
+float getOutputDifference(Network& network, TestStaticNetwork& staticNetwork) {
+	float difference = 0.0f;
+	for (int i = 0; i < 8; i++) {
+		TrainingData sample({ i * 0.125f, 1.0f - i * 0.25f }, { 0.0f, 0.0f, 0.0f });
+		network.setInputs(sample, 0);
+		network.propagateForward(0);
+		const TestStaticNetwork::Outputs outputs = staticNetwork.predict({ sample.inputs(0), sample.inputs(1) });
+		for (unsigned int j = 0; j < TestStaticNetwork::outputSize; j++) {
+			difference = std::max(difference, std::fabs(network.getOutputLayer()->getOutputs()(j, 0) - outputs[j]));
+		}
+	}
+	return difference;
+}
+
+// both networks start from the same parameters for the same seed, train the same way and read each other's models
+void testStaticNetwork() {
+	const std::initializer_list<Activation> activations = { Activation::ReLU, Activation::Tanh, Activation::Sigmoid, Activation::Softmax };
+	// the static network computes exp with its own approximation, so outputs only agree up to rounding
+	const float tolerance = 1e-4f;
+
+	seedThreadRandom(2);
+	Network network({ 2, 30, 20, 10, 3 }, activations, 32, 1);
+	network.setLoss(Loss::CrossEntropy);
+	network.setLearningRate(0.05f);
+	seedThreadRandom(2);
+	TestStaticNetwork staticNetwork(activations);
+	staticNetwork.setLoss(Loss::CrossEntropy);
+	staticNetwork.setLearningRate(0.05f);
+	if (getOutputDifference(network, staticNetwork) > tolerance) {
+		throw std::runtime_error("StaticNetwork initialization test failed");
+	}
+
+	for (int i = 0; i < 2000; i++) {
+		const float x = (i % 16) / 16.0f;
+		const float y = (i % 7) / 7.0f;
+		TrainingData sample({ x, y }, { (x > y) ? 1.0f : 0.0f, (x <= y) ? 1.0f : 0.0f, 0.0f });
+		network.train(sample, i % 8 == 7, 0);
+		staticNetwork.train({ x, y }, { sample.outputs(0), sample.outputs(1), sample.outputs(2) }, i % 8 == 7);
+	}
+	if (getOutputDifference(network, staticNetwork) > tolerance) {
+		throw std::runtime_error("StaticNetwork training test failed");
+	}
+
+	network.save("test_network.dpn");
+	TestStaticNetwork loadedStatic(activations);
+	loadedStatic.load("test_network.dpn");
+	if (getOutputDifference(network, loadedStatic) > tolerance) {
+		throw std::runtime_error("StaticNetwork load test failed");
+	}
+
+	staticNetwork.save("test_static_network.dpn");
+	Network loadedNetwork({ 2, 30, 20, 10, 3 }, activations, 32, 1);
+	loadedNetwork.load("test_static_network.dpn");
+	if (getOutputDifference(loadedNetwork, staticNetwork) > tolerance) {
+		throw std::runtime_error("StaticNetwork save test failed");
+	}
+
+	// a model with other layer sizes is rejected
+	Network smallNetwork({ 2, 4, 3 }, 32, 1);
+	smallNetwork.save("test_small_network.dpn");
+	bool thrown = false;
+	try {
+		loadedStatic.load("test_small_network.dpn");
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	if (!thrown) {
+		throw std::runtime_error("StaticNetwork layer size test failed");
+	}
+	std::cout << "StaticNetwork test passed" << std::endl;
+}
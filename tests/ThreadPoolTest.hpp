@@ -0,0 +1,191 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include "ThreadPool.hpp"
+
+// the owner pushes and pops while thieves steal, every task has to be taken exactly once, also across buffer growth
+void testTaskDeque() {
+	constexpr unsigned int taskCount = 20000;
+	constexpr unsigned int thiefCount = 3;
+	TaskDeque deque;
+	std::vector<std::atomic<unsigned int>> taken(taskCount);
+	std::atomic<bool> done = false;
+
+	std::vector<std::thread> thieves;
+	for (unsigned int i = 0; i < thiefCount; i++) {
+		thieves.push_back(std::thread([&deque, &taken, &done]() {
+			Task task;
+			while (!done.load()) {
+				if (deque.steal(task)) {
+					taken[task.begin].fetch_add(1);
+				}
+			}
+		}));
+	}
+
+	Task task;
+	for (unsigned int i = 0; i < taskCount; i++) {
+		deque.push({ nullptr, i, i + 1 });
+		// pops every third task, so the deque keeps growing while thieves take from the other end
+		if (i % 3 == 0 && deque.pop(task)) {
+			taken[task.begin].fetch_add(1);
+		}
+	}
+	while (deque.pop(task)) {
+		taken[task.begin].fetch_add(1);
+	}
+	done.store(true);
+	for (std::thread& thief : thieves) {
+		thief.join();
+	}
+
+	for (unsigned int i = 0; i < taskCount; i++) {
+		if (taken[i].load() != 1) {
+			throw std::runtime_error("TaskDeque test failed");
+		}
+	}
+	std::cout << "TaskDeque test passed" << std::endl;
+}
+
+// burns time growing with i, so the repeats of a job are uneven and idle workers have to steal from busy ones
+void unevenWork(int i) {
+	volatile float sink = 0.0f;
+	for (int k = 0; k < (i % 64) * 16; k++) {
+		sink = sink + 1.0f;
+	}
+}
+
+// every repeat of jobs split over the worker deques runs exactly once on a valid worker
+void testWorkStealing() {
+	constexpr int threadCount = 4;
+	constexpr unsigned int count = 5000;
+	ThreadPool pool(threadCount);
+	std::vector<std::atomic<unsigned int>> runs(count);
+	std::atomic<bool> validThreads = true;
+	for (int job = 0; job < 4; job++) {
+		pool.addJob([&runs, &validThreads](int i, int threadId) {
+			if (threadId < 0 || threadId >= threadCount) {
+				validThreads.store(false);
+			}
+			unevenWork(i);
+			runs[i].fetch_add(1);
+		}, count);
+	}
+	pool.wait();
+	for (unsigned int i = 0; i < count; i++) {
+		if (runs[i].load() != 4) {
+			throw std::runtime_error("ThreadPool work stealing test failed");
+		}
+	}
+	if (!validThreads.load()) {
+		throw std::runtime_error("ThreadPool thread id test failed");
+	}
+	std::cout << "ThreadPool work stealing test passed" << std::endl;
+}
+
+// parallelFor runs every index once, inline without threads, and only waits for its own range when called from several threads
+void testParallelFor() {
+	for (int threadCount : { 0, 1, 4 }) {
+		ThreadPool pool(threadCount);
+		const int workers = std::max(threadCount, 1);
+
+		constexpr int count = 5000;
+		std::vector<std::atomic<unsigned int>> runs(count);
+		std::atomic<bool> validThreads = true;
+		pool.parallelFor(0, count, 1, [&runs, &validThreads, workers](int i, int threadId) {
+			if (threadId < 0 || threadId >= workers) {
+				validThreads.store(false);
+			}
+			unevenWork(i);
+			runs[i].fetch_add(1);
+		});
+		for (int i = 0; i < count; i++) {
+			if (runs[i].load() != 1) {
+				throw std::runtime_error("ThreadPool parallelFor test failed");
+			}
+		}
+		if (!validThreads.load()) {
+			throw std::runtime_error("ThreadPool parallelFor thread id test failed");
+		}
+
+		// a range that does not start at 0 is offset correctly
+		std::atomic<int> sum = 0;
+		pool.parallelFor(-10, 10, 3, [&sum](int i, int) {
+			sum.fetch_add(i);
+		});
+		if (sum.load() != -10) {
+			throw std::runtime_error("ThreadPool parallelFor range test failed");
+		}
+
+		std::vector<std::thread> callers;
+		std::atomic<unsigned int> callerRuns = 0;
+		std::atomic<bool> callersComplete = true;
+		for (int caller = 0; caller < 3; caller++) {
+			callers.push_back(std::thread([&pool, &callerRuns, &callersComplete]() {
+				std::atomic<unsigned int> ownRuns = 0;
+				pool.parallelFor(0, 1000, 0, [&ownRuns, &callerRuns](int, int) {
+					ownRuns.fetch_add(1);
+					callerRuns.fetch_add(1);
+				});
+				if (ownRuns.load() != 1000) {
+					callersComplete.store(false);
+				}
+			}));
+		}
+		for (std::thread& caller : callers) {
+			caller.join();
+		}
+		if (!callersComplete.load() || callerRuns.load() != 3000) {
+			throw std::runtime_error("ThreadPool concurrent parallelFor test failed");
+		}
+	}
+	std::cout << "ThreadPool parallelFor test passed" << std::endl;
+}
+
+// wait returns only once every job added before it is done, also when the workers parked before the jobs were added
+void testThreadPoolWait() {
+	ThreadPool pool(4);
+	pool.wait();
+	if (pool.isOccupied()) {
+		throw std::runtime_error("ThreadPool idle wait test failed");
+	}
+
+	for (int round = 0; round < 3; round++) {
+		// long enough for the workers to stop spinning and park
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		std::atomic<unsigned int> jobRuns = 0;
+		for (int job = 0; job < 8; job++) {
+			pool.addJob([&jobRuns](int i, int) {
+				unevenWork(i);
+				jobRuns.fetch_add(1);
+			}, 100 + job);
+		}
+		pool.wait();
+		if (jobRuns.load() != 8 * 100 + 28 || pool.isOccupied()) {
+			throw std::runtime_error("ThreadPool wait test failed");
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		std::atomic<unsigned int> rangeRuns = 0;
+		pool.parallelFor(0, 100, 1, [&rangeRuns](int, int) {
+			rangeRuns.fetch_add(1);
+		});
+		if (rangeRuns.load() != 100) {
+			throw std::runtime_error("ThreadPool parallelFor after parking test failed");
+		}
+	}
+	std::cout << "ThreadPool wait test passed" << std::endl;
+}
+
+void testThreadPool() {
+	testTaskDeque();
+	testWorkStealing();
+	testParallelFor();
+	testThreadPoolWait();
+}
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+#include "Matrix.hpp"
+#include "Kernels.hpp"
+
+#include "ThreadPoolTest.hpp"
+#include "StaticNetworkTest.hpp"
+#include "DataLoaderTest.hpp"
+#include "RandomTest.hpp"
+#include "IDXTest.hpp"
+#include "InferenceNetworkTest.hpp"
+#include "InputBatchTest.hpp"
+#include "ParallelLayerTest.hpp"
+#include "OptimizerTest.hpp"
+#include "HogwildTest.hpp"
+
+// runs the test named by the first argument, or all of them without arguments
+// a failed test throws, so the process exits with an error
+int main(int argc, char** argv) {
+	const std::string name = (argc > 1) ? argv[1] : "";
+	bool found = false;
+	auto run = [&name, &found](const char* testName, void (*test)()) {
+		if (name.empty() || name == testName) {
+			test();
+			found = true;
+		}
+	};
+
+	try {
+		run("kernels", testKernels);
+		run("matrix", testMatrix);
+		run("thread_pool", testThreadPool);
+		run("static_network", testStaticNetwork);
+		run("data_loader", testDataLoader);
+		run("random", testRandom);
+		run("idx", testIDX);
+		run("inference_network", testInferenceNetwork);
+		run("input_batch", testInputBatches);
+		run("parallel_layers", testParallelLayers);
+		run("optimizer", testOptimizers);
+		run("hogwild", testHogwild);
+	}
+	catch (const std::exception& exception) {
+		std::cout << exception.what() << std::endl;
+		return 1;
+	}
+
+	if (!found) {
+		std::cout << "Unknown test " << name << std::endl;
+		return 1;
+	}
+	return 0;
+}